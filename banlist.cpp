@@ -1,9 +1,10 @@
 #include "banlist.hpp"
 
-#include <cstdio>
 #include <exception>
 #include <nlohmann/json.hpp>
 
+#include "util/logger.hpp"
+
 namespace YGOpen
 {
 
@@ -30,7 +31,7 @@ bool Banlist::FromJSON(nlohmann::json& j)
 	v = j.at("forbidden").get<std::vector<int>>();
 	forbidden = std::set<int>(v.begin(), v.end());
 
-	std::printf("Loaded banlist %s\n", j["name"].get<std::string>().c_str());
+	Logger::Info(LogCategory::Banlist, "Loaded banlist %s", j["name"].get<std::string>());
 
 	return true;
 }
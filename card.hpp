@@ -1,6 +1,8 @@
 #ifndef __CARD_HPP__
 #define __CARD_HPP__
-#include <string>
+#include <memory>
+
+#include "util/string_arena.hpp"
 
 namespace YGOpen
 {
@@ -28,12 +30,43 @@ struct CardDataExtra
 	unsigned int category;
 };
 
+// Offsets into the string arena the card was loaded into, see CardText
 struct CardStrings
 {
 	unsigned int code;
-	std::string name;
-	std::string desc;
-	std::string str[16];
+	TextRef name;
+	TextRef desc;
+	TextRef str[16];
+};
+
+// CardStrings resolved against their arena. Evaluates to false when
+// the card was not found. References outside of the arena (i.e. from a
+// corrupt snapshot) resolve to empty strings. Text that can be evicted
+// (lazy loading) is kept alive by owner.
+class CardText
+{
+	const char* base;
+	std::size_t size;
+	const CardStrings* cs;
+	std::shared_ptr<const void> owner;
+
+	StringView Resolve(const TextRef& ref) const
+	{
+		if(ref.length == 0 || ref.offset > size || ref.length > size - ref.offset)
+			return StringView();
+		return StringView(base + ref.offset, ref.length);
+	}
+public:
+	CardText() : base(nullptr), size(0), cs(nullptr) {}
+	CardText(const char* base, std::size_t size, const CardStrings* cs, std::shared_ptr<const void> owner = nullptr) :
+		base(base), size(size), cs(cs), owner(std::move(owner)) {}
+
+	explicit operator bool() const { return cs != nullptr; }
+
+	unsigned int Code() const { return cs->code; }
+	StringView Name() const { return Resolve(cs->name); }
+	StringView Desc() const { return Resolve(cs->desc); }
+	StringView Str(int i) const { return Resolve(cs->str[i]); }
 };
 
 } // namespace YGOpen
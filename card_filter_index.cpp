@@ -0,0 +1,287 @@
+#include "card_filter_index.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#include "setcode.hpp"
+
+namespace YGOpen
+{
+
+static inline std::size_t PopCount(uint64_t word)
+{
+#ifdef _MSC_VER
+	return (std::size_t)__popcnt64(word);
+#else
+	return (std::size_t)__builtin_popcountll(word);
+#endif
+}
+
+CardBitset::CardBitset() : bits(0)
+{}
+
+CardBitset::CardBitset(std::size_t size, bool value) :
+	words((size + 63) / 64, value ? ~(uint64_t)0 : 0),
+	bits(size)
+{
+	if(value && (size % 64) != 0)
+		words.back() &= ((uint64_t)1 << (size % 64)) - 1;
+}
+
+std::size_t CardBitset::Size() const
+{
+	return bits;
+}
+
+std::size_t CardBitset::Count() const
+{
+	std::size_t total = 0;
+	for(auto word : words)
+		total += PopCount(word);
+	return total;
+}
+
+bool CardBitset::Any() const
+{
+	for(auto word : words)
+	{
+		if(word != 0)
+			return true;
+	}
+	return false;
+}
+
+bool CardBitset::Test(std::size_t pos) const
+{
+	return (words[pos / 64] >> (pos % 64)) & 1;
+}
+
+void CardBitset::Set(std::size_t pos)
+{
+	words[pos / 64] |= (uint64_t)1 << (pos % 64);
+}
+
+uint64_t* CardBitset::Data()
+{
+	return words.data();
+}
+
+const uint64_t* CardBitset::Data() const
+{
+	return words.data();
+}
+
+CardBitset& CardBitset::operator&=(const CardBitset& other)
+{
+	for(std::size_t i = 0; i < words.size(); ++i)
+		words[i] &= other.words[i];
+	return *this;
+}
+
+CardBitset& CardBitset::operator|=(const CardBitset& other)
+{
+	for(std::size_t i = 0; i < words.size(); ++i)
+		words[i] |= other.words[i];
+	return *this;
+}
+
+CardBitset& CardBitset::AndNot(const CardBitset& other)
+{
+	for(std::size_t i = 0; i < words.size(); ++i)
+		words[i] &= ~other.words[i];
+	return *this;
+}
+
+CardBitset& CardBitset::Invert()
+{
+	for(auto& word : words)
+		word = ~word;
+	if((bits % 64) != 0)
+		words.back() &= ((uint64_t)1 << (bits % 64)) - 1;
+	return *this;
+}
+
+CardFilterIndex::CardFilterIndex() :
+	records(nullptr),
+	count(0)
+{}
+
+void CardFilterIndex::Build(const CardRecord* recs, std::size_t n)
+{
+	records = recs;
+	count = n;
+	for(int bit = 0; bit < 32; ++bit)
+	{
+		types[bit] = CardBitset(n);
+		attributes[bit] = CardBitset(n);
+		races[bit] = CardBitset(n);
+	}
+
+	std::vector<std::pair<int, unsigned int>> atk, def, lv;
+	std::vector<std::pair<uint16_t, unsigned int>> sets;
+	atk.reserve(n);
+	def.reserve(n);
+	lv.reserve(n);
+	setcodes.resize(n);
+	for(std::size_t i = 0; i < n; ++i)
+	{
+		const CardData& cd = records[i].data;
+		for(int bit = 0; bit < 32; ++bit)
+		{
+			if(cd.type & (1u << bit))
+				types[bit].Set(i);
+			if(cd.attribute & (1u << bit))
+				attributes[bit].Set(i);
+			if(cd.race & (1u << bit))
+				races[bit].Set(i);
+		}
+		atk.emplace_back(cd.attack, (unsigned int)i);
+		def.emplace_back(cd.defense, (unsigned int)i);
+		lv.emplace_back((int)cd.level, (unsigned int)i);
+
+		setcodes[i] = cd.setcode;
+		// Same codes as IsSetCard matches: any non-empty one, even those
+		// whose archetype bits are all zero (only sub-archetype bits)
+		for(unsigned long long packed = cd.setcode; packed != 0; packed >>= 16)
+		{
+			if((packed & 0xFFFF) != 0)
+				sets.emplace_back((uint16_t)(packed & 0x0FFF), (unsigned int)i);
+		}
+	}
+
+	// A card listing two sub-archetypes of the same archetype appears once
+	std::sort(sets.begin(), sets.end());
+	sets.erase(std::unique(sets.begin(), sets.end()), sets.end());
+	archetypes.clear();
+	archetypeOffsets.clear();
+	archetypePositions.resize(sets.size());
+	for(std::size_t i = 0; i < sets.size(); ++i)
+	{
+		if(archetypes.empty() || archetypes.back() != sets[i].first)
+		{
+			archetypes.push_back(sets[i].first);
+			archetypeOffsets.push_back((unsigned int)i);
+		}
+		archetypePositions[i] = sets[i].second;
+	}
+	archetypeOffsets.push_back((unsigned int)sets.size());
+
+	auto fill = [](Column& column, std::vector<std::pair<int, unsigned int>>& pairs)
+	{
+		std::sort(pairs.begin(), pairs.end());
+		column.values.resize(pairs.size());
+		column.positions.resize(pairs.size());
+		for(std::size_t i = 0; i < pairs.size(); ++i)
+		{
+			column.values[i] = pairs[i].first;
+			column.positions[i] = pairs[i].second;
+		}
+	};
+	fill(attack, atk);
+	fill(defense, def);
+	fill(level, lv);
+}
+
+std::size_t CardFilterIndex::Size() const
+{
+	return count;
+}
+
+const CardRecord& CardFilterIndex::GetRecord(std::size_t pos) const
+{
+	return records[pos];
+}
+
+CardBitset CardFilterIndex::AnyBit(const CardBitset (&bitsets)[32], unsigned int mask) const
+{
+	CardBitset result(count);
+	for(int bit = 0; bit < 32; ++bit)
+	{
+		if(mask & (1u << bit))
+			result |= bitsets[bit];
+	}
+	return result;
+}
+
+CardBitset CardFilterIndex::Range(const Column& column, int min, int max) const
+{
+	CardBitset result(count);
+	auto first = std::lower_bound(column.values.begin(), column.values.end(), min);
+	auto last = std::upper_bound(first, column.values.end(), max);
+	for(auto it = first; it != last; ++it)
+		result.Set(column.positions[it - column.values.begin()]);
+	return result;
+}
+
+CardBitset CardFilterIndex::All() const
+{
+	return CardBitset(count, true);
+}
+
+CardBitset CardFilterIndex::AnyType(unsigned int mask) const
+{
+	return AnyBit(types, mask);
+}
+
+CardBitset CardFilterIndex::AllTypes(unsigned int mask) const
+{
+	CardBitset result(count, true);
+	for(int bit = 0; bit < 32; ++bit)
+	{
+		if(mask & (1u << bit))
+			result &= types[bit];
+	}
+	return result;
+}
+
+CardBitset CardFilterIndex::AnyAttribute(unsigned int mask) const
+{
+	return AnyBit(attributes, mask);
+}
+
+CardBitset CardFilterIndex::AnyRace(unsigned int mask) const
+{
+	return AnyBit(races, mask);
+}
+
+CardBitset CardFilterIndex::AttackRange(int min, int max) const
+{
+	return Range(attack, min, max);
+}
+
+CardBitset CardFilterIndex::DefenseRange(int min, int max) const
+{
+	return Range(defense, min, max);
+}
+
+CardBitset CardFilterIndex::LevelRange(int min, int max) const
+{
+	return Range(level, min, max);
+}
+
+CardBitset CardFilterIndex::Archetype(unsigned int setcode) const
+{
+	CardBitset result(count);
+	auto search = std::lower_bound(archetypes.begin(), archetypes.end(), (uint16_t)(setcode & 0x0FFF));
+	if(search == archetypes.end() || *search != (setcode & 0x0FFF))
+		return result;
+
+	const std::size_t index = search - archetypes.begin();
+	const bool checkSubtype = (setcode & 0xF000) != 0;
+	for(unsigned int i = archetypeOffsets[index]; i < archetypeOffsets[index + 1]; ++i)
+	{
+		const unsigned int pos = archetypePositions[i];
+		if(!checkSubtype || IsSetCard(setcodes[pos], setcode))
+			result.Set(pos);
+	}
+	return result;
+}
+
+CardBitset CardFilterIndex::ArchetypeScan(unsigned int setcode) const
+{
+	CardBitset result(count);
+	MatchSetCards(setcodes.data(), count, setcode, result.Data());
+	return result;
+}
+
+} // namespace YGOpen
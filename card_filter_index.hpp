@@ -0,0 +1,125 @@
+#ifndef __CARD_FILTER_INDEX_HPP__
+#define __CARD_FILTER_INDEX_HPP__
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "card_store.hpp"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace YGOpen
+{
+
+// One bit per card position of a CardFilterIndex
+class CardBitset
+{
+	std::vector<uint64_t> words;
+	std::size_t bits;
+
+	static inline unsigned int TrailingZeros(uint64_t word)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward64(&index, word);
+		return (unsigned int)index;
+#else
+		return (unsigned int)__builtin_ctzll(word);
+#endif
+	}
+public:
+	CardBitset();
+	explicit CardBitset(std::size_t size, bool value = false);
+
+	std::size_t Size() const;
+	std::size_t Count() const;
+	bool Any() const;
+	bool Test(std::size_t pos) const;
+	void Set(std::size_t pos);
+
+	// (Size() + 63) / 64 words, bit i of word i / 64 is position i
+	uint64_t* Data();
+	const uint64_t* Data() const;
+
+	CardBitset& operator&=(const CardBitset& other);
+	CardBitset& operator|=(const CardBitset& other);
+	CardBitset& AndNot(const CardBitset& other);
+	CardBitset& Invert();
+
+	// Calls f(pos) for every set bit, in increasing order
+	template<typename F>
+	void ForEach(F f) const
+	{
+		for(std::size_t i = 0; i < words.size(); ++i)
+		{
+			uint64_t word = words[i];
+			while(word != 0)
+			{
+				f(i * 64 + TrailingZeros(word));
+				word &= word - 1;
+			}
+		}
+	}
+};
+
+// Columnar index over a CardStore's records, built once per pool, so
+// filters (AnnounceCardFilter, deck builder searches) combine whole
+// columns 64 cards at a time instead of testing each card.
+// Positions are record positions of the store the index was built from.
+class CardFilterIndex
+{
+	struct Column
+	{
+		std::vector<int> values; // Sorted
+		std::vector<unsigned int> positions; // Position of each value
+	};
+
+	const CardRecord* records;
+	std::size_t count;
+	CardBitset types[32]; // One per type bit
+	CardBitset attributes[32];
+	CardBitset races[32];
+	Column attack;
+	Column defense;
+	Column level;
+	std::vector<unsigned long long> setcodes; // In position order
+
+	// Archetype -> positions of the cards that have it, sorted by archetype
+	// (low 12 bits of a setcode), positions of each one are contiguous
+	std::vector<uint16_t> archetypes;
+	std::vector<unsigned int> archetypeOffsets; // archetypes.size() + 1 entries
+	std::vector<unsigned int> archetypePositions;
+
+	CardBitset AnyBit(const CardBitset (&bitsets)[32], unsigned int mask) const;
+	CardBitset Range(const Column& column, int min, int max) const;
+public:
+	CardFilterIndex();
+
+	void Build(const CardRecord* records, std::size_t count);
+
+	std::size_t Size() const;
+	const CardRecord& GetRecord(std::size_t pos) const;
+
+	CardBitset All() const;
+	CardBitset AnyType(unsigned int mask) const;
+	CardBitset AllTypes(unsigned int mask) const;
+	CardBitset AnyAttribute(unsigned int mask) const;
+	CardBitset AnyRace(unsigned int mask) const;
+
+	// Inclusive ranges
+	CardBitset AttackRange(int min, int max) const;
+	CardBitset DefenseRange(int min, int max) const;
+	CardBitset LevelRange(int min, int max) const;
+
+	// Cards of the given archetype, honoring sub-archetypes (see IsSetCard)
+	CardBitset Archetype(unsigned int setcode) const;
+	// Same, but testing the whole setcode column instead of using the
+	// archetype index; useful to check both agree
+	CardBitset ArchetypeScan(unsigned int setcode) const;
+};
+
+} // namespace YGOpen
+
+#endif // __CARD_FILTER_INDEX_HPP__
@@ -0,0 +1,428 @@
+#include "card_pool.hpp"
+#include <sqlite3.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <thread>
+
+#include "enums/type.hpp"
+#include "card.hpp"
+#include "setcode.hpp"
+#include "util/logger.hpp"
+
+namespace YGOpen
+{
+
+//static const char * errorString  = "???";
+static const char* sqlSelect = "select * from datas,texts where datas.id=texts.id";
+static const char* sqlSelectData = "select datas.* from datas,texts where datas.id=texts.id";
+static const char* sqlSelectText = "select texts.* from datas,texts where datas.id=?1 and texts.id=datas.id";
+
+// Reads name, desc and the 16 hint strings starting at column,
+// storing each of them through intern
+template<typename Intern>
+static void ReadTextColumns(sqlite3_stmt* stmt, int column, CardStrings* cs, Intern intern)
+{
+	auto text = [stmt, &intern](int i) -> TextRef
+	{
+		const char* str = (const char*)sqlite3_column_text(stmt, i);
+		const int length = sqlite3_column_bytes(stmt, i);
+		return intern(str, (str != nullptr) ? (std::size_t)length : 0);
+	};
+
+	cs->name = text(column);
+	cs->desc = text(column + 1);
+	for(int i = 0; i < 16; ++i)
+		cs->str[i] = text(column + 2 + i);
+}
+
+TextSource::TextSource(sqlite3* db, sqlite3_stmt* stmt) :
+	db(db),
+	stmt(stmt)
+{}
+
+TextSource::~TextSource()
+{
+	sqlite3_finalize(stmt);
+	sqlite3_close(db);
+}
+
+static std::atomic<unsigned long long> nextPoolId(1);
+
+CardPool::CardPool(TextLoading textLoading, std::size_t textCacheSize) :
+	id(nextPoolId.fetch_add(1, std::memory_order_relaxed)),
+	textLoading(textLoading),
+	textCacheSize(std::max<std::size_t>(textCacheSize, 1))
+{}
+
+std::unique_ptr<CardPool> CardPool::Clone() const
+{
+	std::unique_ptr<CardPool> pool(new CardPool(textLoading, textCacheSize));
+	if(!pool->store.CopyFrom(store))
+		return nullptr;
+	pool->textSources = textSources;
+	pool->BuildIndexes();
+	return pool;
+}
+
+void CardPool::ReadCardData(sqlite3_stmt* stmt, CardData* cd, CardDataExtra* cde)
+{
+	// Card Data
+	cd->code = sqlite3_column_int(stmt, 0);
+	// ot is 1, it is added to the extra card struct
+	cd->alias = sqlite3_column_int(stmt, 2);
+	cd->setcode = sqlite3_column_int64(stmt, 3);
+	cd->type = sqlite3_column_int(stmt, 4);
+	cd->attack = sqlite3_column_int(stmt, 5);
+	cd->defense = sqlite3_column_int(stmt, 6);
+	if(cd->type & TypeLink)
+	{
+		cd->link_marker = cd->defense;
+		cd->defense = 0;
+	}
+	else cd->link_marker = 0;
+	unsigned int level = sqlite3_column_int(stmt, 7);
+	if((level & 0x80000000) != 0) // Negative levels are handled too
+	{
+		level = -level;
+		cd->level = -(level & 0xFF);
+	}
+	else cd->level = level & 0xFF;
+	cd->lscale = (level >> 24) & 0xFF;
+	cd->rscale = (level >> 16) & 0xFF;
+	cd->race = sqlite3_column_int(stmt, 8);
+	cd->attribute = sqlite3_column_int(stmt, 9);
+
+	// Card Data Extra
+	cde->code = sqlite3_column_int(stmt, 0); 
+	cde->ot = sqlite3_column_int(stmt, 1);
+	cde->category = sqlite3_column_int(stmt, 10);
+}
+
+void CardPool::ReadCardStrings(sqlite3_stmt* stmt, CardStrings* cs, StringArena& arena)
+{
+	// 11 is id again, skip it
+	ReadTextColumns(stmt, 12, cs, [&arena](const char* str, std::size_t length)
+	{
+		return arena.Intern(str, length);
+	});
+}
+
+CardText CardPool::FetchText(unsigned int code) const
+{
+	// The entry goes along, so the text outlives its eviction
+	auto cached = [](const std::shared_ptr<const CachedText>& entry)
+	{
+		return CardText(entry->text.data(), entry->text.size(), &entry->cs, entry);
+	};
+
+	{
+		std::lock_guard<std::mutex> lock(textMutex);
+		auto search = textCacheIndex.find(code);
+		if(search != textCacheIndex.end())
+		{
+			textCache.splice(textCache.begin(), textCache, search->second);
+			return cached(textCache.front());
+		}
+	}
+
+	// Newest database first, same as the overriding done when loading
+	for(auto it = textSources.rbegin(); it != textSources.rend(); ++it)
+	{
+		std::shared_ptr<CachedText> entry;
+		{
+			// Sources are shared with the pools this one was cloned from
+			std::lock_guard<std::mutex> sourceLock((*it)->mutex);
+			sqlite3_stmt* stmt = (*it)->stmt;
+			sqlite3_reset(stmt);
+			sqlite3_bind_int64(stmt, 1, code);
+			if(sqlite3_step(stmt) != SQLITE_ROW)
+				continue;
+
+			entry = std::make_shared<CachedText>();
+			entry->cs.code = code;
+			// 0 is id, skip it
+			ReadTextColumns(stmt, 1, &entry->cs, [&entry](const char* str, std::size_t length)
+			{
+				TextRef ref = {(uint32_t)entry->text.size(), (uint32_t)length};
+				entry->text.append(str, length);
+				return ref;
+			});
+			sqlite3_reset(stmt);
+		}
+
+		std::lock_guard<std::mutex> lock(textMutex);
+		// Another thread might have cached it meanwhile
+		auto search = textCacheIndex.find(code);
+		if(search != textCacheIndex.end())
+		{
+			textCache.splice(textCache.begin(), textCache, search->second);
+			return cached(textCache.front());
+		}
+		if(textCache.size() >= textCacheSize)
+		{
+			textCacheIndex.erase(textCache.back()->cs.code);
+			textCache.pop_back();
+		}
+		textCache.push_front(entry);
+		textCacheIndex[code] = textCache.begin();
+		return cached(entry);
+	}
+
+	// Not in any database, it might still come from a snapshot
+	return store.FindText(code);
+}
+
+bool CardPool::ReadDatabase(const char* fn, StagedDatabase* staged) const
+{
+	sqlite3* db;
+	sqlite3_stmt* stmt;
+	
+	if(sqlite3_open_v2(fn, &db, SQLITE_OPEN_READONLY, 0) != SQLITE_OK)
+	{
+		Logger::Error(LogCategory::Database, "%s: %s", fn, sqlite3_errmsg(db));
+		sqlite3_close(db);
+		return false;
+	}
+
+	const bool lazy = (textLoading == TextLoading::Lazy);
+	sqlite3_stmt* textStmt = nullptr;
+	if(lazy && sqlite3_prepare_v2(db, sqlSelectText, -1, &textStmt, 0) != SQLITE_OK)
+	{
+		Logger::Error(LogCategory::Database, "%s: %s", fn, sqlite3_errmsg(db));
+		sqlite3_close(db);
+		return false;
+	}
+
+	if(sqlite3_prepare_v2(db, lazy ? sqlSelectData : sqlSelect, -1, &stmt, 0) != SQLITE_OK)
+	{
+		Logger::Error(LogCategory::Database, "%s: %s", fn, sqlite3_errmsg(db));
+		sqlite3_finalize(textStmt);
+		sqlite3_close(db);
+		return false;
+	}
+
+	// Cleared so padding bytes are deterministic when written to a snapshot
+	CardRecord record;
+	CardStrings cs;
+	std::memset(&record, 0, sizeof(CardRecord));
+	std::memset(&cs, 0, sizeof(CardStrings));
+
+	for(int step = SQLITE_OK; step != SQLITE_DONE; step = sqlite3_step(stmt))
+	{
+		if(step == SQLITE_BUSY || step == SQLITE_ERROR || step == SQLITE_MISUSE)
+		{
+			Logger::Error(LogCategory::Database, "%s: %s", fn, sqlite3_errmsg(db));
+			sqlite3_finalize(stmt);
+			sqlite3_finalize(textStmt);
+			sqlite3_close(db);
+			return false;
+		}
+		else if(step == SQLITE_ROW)
+		{
+			ReadCardData(stmt, &record.data, &record.extra);
+			if(!lazy)
+				ReadCardStrings(stmt, &cs, staged->arena);
+			cs.code = record.data.code;
+			staged->records.push_back(record);
+			staged->strings.push_back(cs);
+		}
+	}
+	sqlite3_finalize(stmt);
+
+	if(lazy)
+		staged->source = std::make_shared<TextSource>(db, textStmt); // Kept open for text lookups
+	else
+		sqlite3_close(db);
+
+	return true;
+}
+
+void CardPool::MergeDatabases(std::vector<StagedDatabase>& staged)
+{
+	std::size_t cardCount = store.Size();
+	std::size_t textSize = 0;
+	for(auto& database : staged)
+	{
+		cardCount += database.records.size();
+		textSize += database.arena.Size();
+	}
+	store.Reserve(cardCount, textSize);
+
+	for(auto& database : staged)
+	{
+		auto intern = [this, &database](TextRef& ref)
+		{
+			StringView str = database.arena.Get(ref);
+			ref = store.InternText(str.Data(), str.Size());
+		};
+		for(std::size_t i = 0; i < database.records.size(); ++i)
+		{
+			const CardRecord& record = database.records[i];
+			CardStrings& cs = database.strings[i];
+			intern(cs.name);
+			intern(cs.desc);
+			for(auto& str : cs.str)
+				intern(str);
+			store.Insert(record.data, record.extra, cs);
+		}
+	}
+
+	if(textLoading == TextLoading::Lazy)
+	{
+		// Cached text might be overridden now
+		std::lock_guard<std::mutex> lock(textMutex);
+		for(auto& database : staged)
+			textSources.push_back(database.source);
+		textCache.clear();
+		textCacheIndex.clear();
+	}
+
+	BuildIndexes();
+}
+
+// Rebuilt whenever the store changes, published pools never change
+void CardPool::BuildIndexes()
+{
+	filterIndex.Build(store.Records(), store.Size());
+}
+
+bool CardPool::LoadDatabase(const char* fn)
+{
+	std::vector<StagedDatabase> staged(1);
+	if(!ReadDatabase(fn, &staged[0]))
+		return false;
+	MergeDatabases(staged);
+
+	Logger::Info(LogCategory::Database, "Number of cards loaded in total: %zu", store.Size());
+
+	return true;
+}
+
+std::size_t CardPool::LoadDatabases(const std::vector<std::string>& fns)
+{
+	std::vector<StagedDatabase> staged(fns.size());
+	std::unique_ptr<bool[]> loaded(new bool[fns.size()]);
+	std::vector<std::thread> workers;
+	workers.reserve(fns.size());
+	for(std::size_t i = 0; i < fns.size(); ++i)
+	{
+		workers.emplace_back([this, &fns, &staged, &loaded, i]()
+		{
+			loaded[i] = ReadDatabase(fns[i].c_str(), &staged[i]);
+		});
+	}
+	for(auto& worker : workers)
+		worker.join();
+
+	std::vector<StagedDatabase> merged;
+	merged.reserve(fns.size());
+	for(std::size_t i = 0; i < fns.size(); ++i)
+	{
+		if(loaded[i])
+			merged.push_back(std::move(staged[i]));
+	}
+	if(merged.empty())
+		return 0;
+	MergeDatabases(merged);
+
+	Logger::Info(LogCategory::Database, "Number of cards loaded in total: %zu", store.Size());
+
+	return merged.size();
+}
+
+bool CardPool::LoadSnapshot(const char* fn)
+{
+	{
+		std::lock_guard<std::mutex> lock(textMutex);
+		textSources.clear();
+		textCache.clear();
+		textCacheIndex.clear();
+	}
+	if(!store.MapSnapshot(fn))
+		return false;
+	BuildIndexes();
+
+	Logger::Info(LogCategory::Database, "Number of cards loaded in total: %zu", store.Size());
+
+	return true;
+}
+
+bool CardPool::SaveSnapshot(const char* fn) const
+{
+	return store.WriteSnapshot(fn);
+}
+
+unsigned long long CardPool::GetId() const
+{
+	return id;
+}
+
+std::size_t CardPool::Size() const
+{
+	return store.Size();
+}
+
+const CardData* CardPool::GetCardDataByCode(unsigned int code) const
+{
+	const CardRecord* record = store.Find(code);
+	return (record != nullptr) ? &record->data : nullptr;
+}
+
+void CardPool::GetCardDataBatch(const unsigned int* codes, std::size_t count, const CardData** out) const
+{
+	const CardRecord* records[64];
+	for(std::size_t first = 0; first < count; first += 64)
+	{
+		const std::size_t n = std::min<std::size_t>(count - first, 64);
+		store.FindBatch(codes + first, n, records);
+		for(std::size_t i = 0; i < n; ++i)
+			out[first + i] = (records[i] != nullptr) ? &records[i]->data : nullptr;
+	}
+}
+
+const CardDataExtra* CardPool::GetCardDataExtraByCode(unsigned int code) const
+{
+	const CardRecord* record = store.Find(code);
+	return (record != nullptr) ? &record->extra : nullptr;
+}
+
+CardText CardPool::GetCardStringsByCode(unsigned int code) const
+{
+	if(textSources.empty())
+		return store.FindText(code);
+	if(store.Find(code) == nullptr)
+		return CardText();
+	return FetchText(code);
+}
+
+const CardFilterIndex& CardPool::GetFilterIndex() const
+{
+	return filterIndex;
+}
+
+std::size_t CardPool::CountArchetype(const unsigned int* codes, std::size_t count, unsigned int setcode) const
+{
+	// Gathered into a contiguous column 64 cards at a time for MatchSetCards
+	unsigned long long column[64];
+	std::size_t total = 0;
+	for(std::size_t first = 0; first < count; first += 64)
+	{
+		const std::size_t n = std::min<std::size_t>(count - first, 64);
+		for(std::size_t i = 0; i < n; ++i)
+		{
+			const CardRecord* record = store.Find(codes[first + i]);
+			column[i] = (record != nullptr) ? record->data.setcode : 0;
+		}
+
+		uint64_t matches;
+		MatchSetCards(column, n, setcode, &matches);
+		for(; matches != 0; matches &= matches - 1)
+			++total;
+	}
+	return total;
+}
+
+} // namespace YGOpen
@@ -0,0 +1,116 @@
+#ifndef __CARD_POOL_HPP__
+#define __CARD_POOL_HPP__
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "card.hpp"
+#include "card_filter_index.hpp"
+#include "card_store.hpp"
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+namespace YGOpen
+{
+
+enum class TextLoading
+{
+	Eager, // Card text is loaded along with the card data
+	Lazy,  // Card text is read from the databases on first use
+};
+
+// An open database used for lazy text loading, shared between clones
+struct TextSource
+{
+	sqlite3* db;
+	sqlite3_stmt* stmt;
+	std::mutex mutex; // Guards stmt
+
+	TextSource(sqlite3* db, sqlite3_stmt* stmt);
+	~TextSource();
+};
+
+// A set of cards loaded from databases and/or a snapshot.
+// DatabaseManager publishes pools and never modifies a published one,
+// so a pool can be read from any thread.
+class CardPool
+{
+	struct CachedText
+	{
+		CardStrings cs;
+		std::string text; // What the CardStrings offsets point into
+	};
+
+	// A database read but not yet merged into the store
+	struct StagedDatabase
+	{
+		std::vector<CardRecord> records;
+		std::vector<CardStrings> strings; // Offsets into arena
+		StringArena arena;
+		std::shared_ptr<TextSource> source; // Only opened for lazy text loading
+	};
+
+	const unsigned long long id;
+	CardStore store;
+	CardFilterIndex filterIndex;
+
+	// Lazy text loading, sources are kept in load order
+	TextLoading textLoading;
+	std::size_t textCacheSize;
+	std::vector<std::shared_ptr<TextSource>> textSources;
+	mutable std::mutex textMutex;
+	// Most recently used first. Entries are never modified once cached,
+	// evicted ones live on as long as a CardText holds them.
+	mutable std::list<std::shared_ptr<const CachedText>> textCache;
+	mutable std::unordered_map<unsigned int, std::list<std::shared_ptr<const CachedText>>::iterator> textCacheIndex;
+
+	static void ReadCardData(sqlite3_stmt* stmt, CardData* cd, CardDataExtra* cde);
+	static void ReadCardStrings(sqlite3_stmt* stmt, CardStrings* cs, StringArena& arena);
+
+	// Safe to call from several threads at once
+	bool ReadDatabase(const char* filepath, StagedDatabase* staged) const;
+	// Later databases override earlier ones
+	void MergeDatabases(std::vector<StagedDatabase>& staged);
+
+	CardText FetchText(unsigned int code) const;
+	void BuildIndexes();
+public:
+	// In lazy mode at most textCacheSize card texts are kept in memory
+	CardPool(TextLoading textLoading, std::size_t textCacheSize);
+
+	// Copies the cards so more databases can be loaded on top, nullptr
+	// if they come from a corrupt snapshot
+	std::unique_ptr<CardPool> Clone() const;
+
+	bool LoadDatabase(const char* filepath);
+	// Reads every database on its own thread, then merges them in the
+	// given order. Returns how many loaded, the ones that failed are
+	// skipped.
+	std::size_t LoadDatabases(const std::vector<std::string>& filepaths);
+
+	// Loading a snapshot replaces every card loaded so far
+	bool LoadSnapshot(const char* filepath);
+	bool SaveSnapshot(const char* filepath) const;
+
+	// Unique for the whole process, ids are never reused
+	unsigned long long GetId() const;
+	std::size_t Size() const;
+	const CardData* GetCardDataByCode(unsigned int code) const;
+	// Resolves count codes at once, out[i] is nullptr for unknown cards
+	void GetCardDataBatch(const unsigned int* codes, std::size_t count, const CardData** out) const;
+	const CardDataExtra* GetCardDataExtraByCode(unsigned int code) const;
+	// The returned text stays valid as long as this pool does, even if
+	// lazy loading evicts it from the cache meanwhile
+	CardText GetCardStringsByCode(unsigned int code) const;
+
+	const CardFilterIndex& GetFilterIndex() const;
+	// How many of the given cards belong to the archetype, for deck analysis
+	std::size_t CountArchetype(const unsigned int* codes, std::size_t count, unsigned int setcode) const;
+};
+
+} // namespace YGOpen
+
+#endif // __CARD_POOL_HPP__
@@ -0,0 +1,443 @@
+#include "card_store.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _MSC_VER
+#include <xmmintrin.h>
+#endif
+
+#include "util/logger.hpp"
+
+namespace YGOpen
+{
+
+static const std::size_t MIN_CAPACITY = 16;
+
+// Snapshot file layout:
+//	SnapshotHeader
+//	CardRecord[cardCount]         at recordsOffset
+//	Slot[slotCount]               at slotsOffset
+//	CardStrings[cardCount]        at textsOffset, same order as the records
+//	char[blobSize]                at blobOffset, the string arena
+static const char SNAPSHOT_MAGIC[8] = {'Y', 'G', 'O', 'C', 'D', 'B', 'S', '\0'};
+static const uint32_t SNAPSHOT_VERSION = 1;
+static const uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304;
+
+struct SnapshotHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t byteOrder;
+	uint32_t recordSize;
+	uint32_t slotSize;
+	uint32_t cardCount;
+	uint32_t slotCount;
+	uint64_t recordsOffset;
+	uint64_t slotsOffset;
+	uint64_t textsOffset;
+	uint64_t blobOffset;
+	uint64_t blobSize;
+};
+
+static inline std::size_t HashCode(unsigned int code)
+{
+	unsigned int h = code * 0x9E3779B1u; // Fibonacci hashing
+	return h ^ (h >> 16);
+}
+
+static inline void Prefetch(const void* ptr)
+{
+#ifdef _MSC_VER
+	_mm_prefetch((const char*)ptr, _MM_HINT_T0);
+#else
+	__builtin_prefetch(ptr);
+#endif
+}
+
+static inline uint64_t AlignOffset(uint64_t offset)
+{
+	return (offset + 7) & ~(uint64_t)7;
+}
+
+CardStore::CardStore() :
+	recordView(nullptr),
+	recordCount(0),
+	slotView(nullptr),
+	slotCount(0),
+	stringView(nullptr),
+	textView(nullptr),
+	textSize(0)
+{}
+
+// Returns slotCount if the table is full without the code, which only a
+// corrupt snapshot can be (owned tables are kept at most half full)
+std::size_t CardStore::FindSlot(unsigned int code) const
+{
+	const std::size_t mask = slotCount - 1;
+	std::size_t i = HashCode(code) & mask;
+	for(std::size_t probes = 0; probes < slotCount; ++probes)
+	{
+		if(slotView[i].code == code || slotView[i].code == 0)
+			return i;
+		i = (i + 1) & mask;
+	}
+	return slotCount;
+}
+
+// The slot holding code, nullptr if there is none. Positions are checked
+// here rather than when mapping, so opening a snapshot stays O(1).
+const CardStore::Slot* CardStore::FindUsedSlot(unsigned int code) const
+{
+	if(slotCount == 0)
+		return nullptr;
+	const std::size_t i = FindSlot(code);
+	if(i == slotCount || slotView[i].code == 0 || slotView[i].pos >= recordCount)
+		return nullptr;
+	return &slotView[i];
+}
+
+void CardStore::Rehash(std::size_t capacity)
+{
+	std::vector<Slot> old;
+	old.swap(slots);
+	slots.assign(capacity, Slot{0, 0});
+	UpdateViews();
+	for(auto& slot : old)
+	{
+		if(slot.code != 0)
+			slots[FindSlot(slot.code)] = slot;
+	}
+}
+
+void CardStore::UpdateViews()
+{
+	recordView = records.data();
+	recordCount = records.size();
+	slotView = slots.data();
+	slotCount = slots.size();
+	stringView = strings.data();
+	textView = arena.Data();
+	textSize = arena.Size();
+}
+
+// Mapped snapshots are only checked as they are read (see MapSnapshot),
+// copying one reads everything so everything is checked first
+bool CardStore::ViewsValid() const
+{
+	std::size_t used = 0;
+	for(std::size_t i = 0; i < slotCount; ++i)
+	{
+		if(slotView[i].code == 0)
+			continue;
+		// More used slots than records could fill the table, see Insert
+		if(slotView[i].pos >= recordCount || ++used > recordCount)
+			return false;
+	}
+
+	auto valid = [this](const TextRef& ref) -> bool
+	{
+		return ref.offset <= textSize && ref.length <= textSize - ref.offset;
+	};
+	for(std::size_t i = 0; i < recordCount; ++i)
+	{
+		const CardStrings& cs = stringView[i];
+		if(!valid(cs.name) || !valid(cs.desc))
+			return false;
+		for(auto& str : cs.str)
+		{
+			if(!valid(str))
+				return false;
+		}
+	}
+	return true;
+}
+
+// Copies what the views of other point to into the owned containers,
+// fails if other is a corrupt snapshot
+bool CardStore::CopyViews(const CardStore& other)
+{
+	if(!other.ViewsValid())
+	{
+		Logger::Error(LogCategory::Database, "Invalid index entry or string reference in snapshot");
+		return false;
+	}
+
+	records.assign(other.recordView, other.recordView + other.recordCount);
+	slots.assign(other.slotView, other.slotView + other.slotCount);
+	strings.assign(other.stringView, other.stringView + other.recordCount);
+
+	// Re-intern the text so new strings can still share it
+	arena.Clear();
+	arena.Reserve(other.textSize, other.recordCount);
+	auto intern = [this, &other](TextRef& ref)
+	{
+		ref = arena.Intern(other.textView + ref.offset, ref.length);
+	};
+	for(auto& cs : strings)
+	{
+		intern(cs.name);
+		intern(cs.desc);
+		for(auto& str : cs.str)
+			intern(str);
+	}
+	return true;
+}
+
+// A corrupt snapshot is dropped, the store is left empty
+void CardStore::Detach()
+{
+	if(!snapshot.IsOpen())
+		return;
+	if(!CopyViews(*this))
+	{
+		Clear();
+		return;
+	}
+	snapshot.Close();
+	UpdateViews();
+}
+
+bool CardStore::CopyFrom(const CardStore& other)
+{
+	if(&other == this)
+		return true;
+	snapshot.Close();
+	if(!CopyViews(other))
+	{
+		Clear();
+		return false;
+	}
+	UpdateViews();
+	return true;
+}
+
+void CardStore::Reserve(std::size_t count, std::size_t textSize)
+{
+	Detach();
+	records.reserve(count);
+	strings.reserve(count);
+	arena.Reserve(textSize, count);
+
+	// Keep the load factor at or below 0.5
+	std::size_t capacity = MIN_CAPACITY;
+	while(capacity < count * 2)
+		capacity <<= 1;
+	if(capacity > slots.size())
+		Rehash(capacity);
+	UpdateViews();
+}
+
+void CardStore::Clear()
+{
+	snapshot.Close();
+	records.clear();
+	strings.clear();
+	slots.clear();
+	arena.Clear();
+	UpdateViews();
+}
+
+std::size_t CardStore::Size() const
+{
+	return recordCount;
+}
+
+const CardRecord* CardStore::Records() const
+{
+	return recordView;
+}
+
+TextRef CardStore::InternText(const char* str, std::size_t length)
+{
+	Detach();
+	TextRef ref = arena.Intern(str, length);
+	UpdateViews();
+	return ref;
+}
+
+void CardStore::Insert(const CardData& cd, const CardDataExtra& cde, const CardStrings& cs)
+{
+	if(cd.code == 0) // Reserved for empty slots, the core never asks for it
+		return;
+
+	Detach();
+	if(slots.empty() || (records.size() + 1) * 2 > slots.size())
+		Rehash(slots.empty() ? MIN_CAPACITY : slots.size() * 2);
+
+	Slot& slot = slots[FindSlot(cd.code)];
+	if(slot.code == cd.code)
+	{
+		records[slot.pos].data = cd;
+		records[slot.pos].extra = cde;
+		strings[slot.pos] = cs;
+		return;
+	}
+
+	slot.code = cd.code;
+	slot.pos = (unsigned int)records.size();
+	records.push_back(CardRecord{cd, cde});
+	strings.push_back(cs);
+	UpdateViews();
+}
+
+const CardRecord* CardStore::Find(unsigned int code) const
+{
+	const Slot* slot = FindUsedSlot(code);
+	return (slot != nullptr) ? &recordView[slot->pos] : nullptr;
+}
+
+void CardStore::FindBatch(const unsigned int* codes, std::size_t count, const CardRecord** out) const
+{
+	if(slotCount == 0)
+	{
+		for(std::size_t i = 0; i < count; ++i)
+			out[i] = nullptr;
+		return;
+	}
+
+	// Enough lookups in flight to hide memory latency, few enough to
+	// keep their prefetched lines in L1
+	static const std::size_t BATCH_SIZE = 16;
+	const std::size_t mask = slotCount - 1;
+	std::size_t home[BATCH_SIZE];
+	for(std::size_t first = 0; first < count; first += BATCH_SIZE)
+	{
+		const std::size_t n = (count - first < BATCH_SIZE) ? count - first : BATCH_SIZE;
+		for(std::size_t i = 0; i < n; ++i)
+		{
+			home[i] = HashCode(codes[first + i]) & mask;
+			Prefetch(&slotView[home[i]]);
+		}
+		for(std::size_t i = 0; i < n; ++i)
+		{
+			const unsigned int code = codes[first + i];
+			std::size_t j = home[i];
+			std::size_t probes = 0;
+			while(slotView[j].code != code && slotView[j].code != 0 && ++probes < slotCount)
+				j = (j + 1) & mask;
+			if(slotView[j].code != code || slotView[j].pos >= recordCount)
+			{
+				out[first + i] = nullptr;
+				continue;
+			}
+			out[first + i] = &recordView[slotView[j].pos];
+			Prefetch(out[first + i]);
+		}
+	}
+}
+
+CardText CardStore::FindText(unsigned int code) const
+{
+	const Slot* slot = FindUsedSlot(code);
+	if(slot == nullptr)
+		return CardText();
+	return CardText(textView, textSize, &stringView[slot->pos]);
+}
+
+bool CardStore::WriteSnapshot(const char* path) const
+{
+	SnapshotHeader header;
+	std::memset(&header, 0, sizeof(SnapshotHeader));
+	std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+	header.version = SNAPSHOT_VERSION;
+	header.byteOrder = SNAPSHOT_BYTE_ORDER;
+	header.recordSize = sizeof(CardRecord);
+	header.slotSize = sizeof(Slot);
+	header.cardCount = (uint32_t)recordCount;
+	header.slotCount = (uint32_t)slotCount;
+	header.recordsOffset = AlignOffset(sizeof(SnapshotHeader));
+	header.slotsOffset = AlignOffset(header.recordsOffset + recordCount * sizeof(CardRecord));
+	header.textsOffset = AlignOffset(header.slotsOffset + slotCount * sizeof(Slot));
+	header.blobOffset = AlignOffset(header.textsOffset + recordCount * sizeof(CardStrings));
+	header.blobSize = textSize;
+
+	std::FILE* fp = std::fopen(path, "wb");
+	if(fp == nullptr)
+	{
+		Logger::Error(LogCategory::Database, "Failed opening %s for writing", path);
+		return false;
+	}
+
+	static const char padding[8] = {0};
+	uint64_t written = 0;
+	auto writeAt = [&](uint64_t offset, const void* data, std::size_t size) -> bool
+	{
+		if(offset > written && std::fwrite(padding, 1, (std::size_t)(offset - written), fp) != offset - written)
+			return false;
+		written = offset + size;
+		return size == 0 || std::fwrite(data, 1, size, fp) == size;
+	};
+
+	const bool ok = writeAt(0, &header, sizeof(SnapshotHeader)) &&
+	                writeAt(header.recordsOffset, recordView, recordCount * sizeof(CardRecord)) &&
+	                writeAt(header.slotsOffset, slotView, slotCount * sizeof(Slot)) &&
+	                writeAt(header.textsOffset, stringView, recordCount * sizeof(CardStrings)) &&
+	                writeAt(header.blobOffset, textView, textSize);
+	if(std::fclose(fp) != 0 || !ok)
+	{
+		Logger::Error(LogCategory::Database, "Failed writing snapshot %s", path);
+		return false;
+	}
+	return true;
+}
+
+bool CardStore::MapSnapshot(const char* path)
+{
+	Clear();
+	if(!snapshot.Open(path))
+		return false;
+
+	const char* base = (const char*)snapshot.Data();
+	const uint64_t size = snapshot.Size();
+	// Only the header is checked here, so mapping does not touch the
+	// whole file: index entries and string references are checked when
+	// they are read (see FindUsedSlot and CardText)
+	auto fits = [size](uint64_t offset, uint64_t length) -> bool
+	{
+		return offset <= size && length <= size - offset && (offset & 7) == 0;
+	};
+
+	SnapshotHeader header;
+	if(size < sizeof(SnapshotHeader))
+	{
+		Logger::Error(LogCategory::Database, "Invalid snapshot %s", path);
+		Clear();
+		return false;
+	}
+	std::memcpy(&header, base, sizeof(SnapshotHeader));
+	if(std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 ||
+	   header.version != SNAPSHOT_VERSION ||
+	   header.byteOrder != SNAPSHOT_BYTE_ORDER ||
+	   header.recordSize != sizeof(CardRecord) ||
+	   header.slotSize != sizeof(Slot) ||
+	   (header.slotCount & (header.slotCount - 1)) != 0 ||
+	   header.cardCount * 2ull > header.slotCount ||
+	   (header.slotCount != 0 && header.cardCount >= header.slotCount) ||
+	   !fits(header.recordsOffset, (uint64_t)header.cardCount * sizeof(CardRecord)) ||
+	   !fits(header.slotsOffset, (uint64_t)header.slotCount * sizeof(Slot)) ||
+	   !fits(header.textsOffset, (uint64_t)header.cardCount * sizeof(CardStrings)) ||
+	   header.blobOffset > size || header.blobSize > size - header.blobOffset)
+	{
+		Logger::Error(LogCategory::Database, "Invalid or incompatible snapshot %s", path);
+		Clear();
+		return false;
+	}
+
+	recordView = (const CardRecord*)(base + header.recordsOffset);
+	recordCount = header.cardCount;
+	slotView = (const Slot*)(base + header.slotsOffset);
+	slotCount = header.slotCount;
+	stringView = (const CardStrings*)(base + header.textsOffset);
+	textView = base + header.blobOffset;
+	textSize = header.blobSize;
+	return true;
+}
+
+bool CardStore::IsMapped() const
+{
+	return snapshot.IsOpen();
+}
+
+} // namespace YGOpen
@@ -0,0 +1,89 @@
+#ifndef __CARD_STORE_HPP__
+#define __CARD_STORE_HPP__
+#include <cstddef>
+#include <vector>
+
+#include "card.hpp"
+#include "util/mapped_file.hpp"
+
+namespace YGOpen
+{
+
+// Everything the core and deck checks need about a card, kept together
+struct CardRecord
+{
+	CardData data;
+	CardDataExtra extra;
+};
+
+// Flat card storage: records are contiguous, strings live in a separate
+// (cold) array with the same ordering, and an open addressing index maps
+// a card code to its position with a single probe in the common case.
+// All card text is kept in a single interned StringArena.
+// Everything can either be owned or live inside a read-only mapped
+// snapshot file (see WriteSnapshot/MapSnapshot).
+class CardStore
+{
+	struct Slot
+	{
+		unsigned int code; // 0 means the slot is empty
+		unsigned int pos;
+	};
+
+	std::vector<CardRecord> records;
+	std::vector<CardStrings> strings;
+	std::vector<Slot> slots; // Linear probing, size is always a power of two
+	StringArena arena;
+
+	// What lookups read, either the containers above or the mapped snapshot
+	const CardRecord* recordView;
+	std::size_t recordCount;
+	const Slot* slotView;
+	std::size_t slotCount;
+	const CardStrings* stringView;
+	const char* textView;
+	std::size_t textSize;
+	MappedFile snapshot;
+
+	std::size_t FindSlot(unsigned int code) const;
+	const Slot* FindUsedSlot(unsigned int code) const;
+	void Rehash(std::size_t capacity);
+	void UpdateViews();
+	bool ViewsValid() const;
+	bool CopyViews(const CardStore& other);
+	void Detach();
+public:
+	CardStore();
+
+	// Copies every card of other into owned storage, even if it is mapped.
+	// Fails, leaving this empty, if other is a corrupt snapshot.
+	bool CopyFrom(const CardStore& other);
+
+	void Reserve(std::size_t count, std::size_t textSize = 0);
+	void Clear();
+	std::size_t Size() const;
+	const CardRecord* Records() const; // Size() records, in position order
+
+	// Stores a string for the CardStrings passed to Insert
+	TextRef InternText(const char* str, std::size_t length);
+
+	// Adds a card, replacing any card previously stored with the same code.
+	// The text of a replaced card stays in the arena.
+	void Insert(const CardData& cd, const CardDataExtra& cde, const CardStrings& cs);
+
+	const CardRecord* Find(unsigned int code) const;
+	// Same as calling Find for each code, but hashes and prefetches the
+	// whole batch first so the cache misses overlap
+	void FindBatch(const unsigned int* codes, std::size_t count, const CardRecord** out) const;
+	CardText FindText(unsigned int code) const;
+
+	// Snapshots are only meant to be read back by the same build
+	// (record layout and byte order are checked when mapping)
+	bool WriteSnapshot(const char* path) const;
+	bool MapSnapshot(const char* path);
+	bool IsMapped() const;
+};
+
+} // namespace YGOpen
+
+#endif // __CARD_STORE_HPP__
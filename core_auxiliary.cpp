@@ -1,47 +1,166 @@
 #include <cstring>
+#include <mutex>
+#include <unordered_map>
 #include "core_auxiliary.hpp"
 
 #include "core_interface.hpp"
 #include "database_manager.hpp"
+#include "script_provider.hpp"
+#include "util/logger.hpp"
 
 namespace YGOpen
 {
 
-CoreInterface* CoreAuxiliary::ci = nullptr;
-DatabaseManager* CoreAuxiliary::dbm = nullptr;
+CoreContext CoreAuxiliary::defaultContext = {nullptr, nullptr, nullptr};
+
+static thread_local const CoreContext* boundContext = nullptr;
+static thread_local const CardPool* boundPool = nullptr;
+
+// Only consulted by the message handler, which is rare enough for a lock
+static std::mutex duelsMutex;
+static std::unordered_multimap<long, CoreInterface*> duels;
+
+const CoreContext& CoreAuxiliary::Current()
+{
+	return (boundContext != nullptr) ? *boundContext : defaultContext;
+}
 
 void CoreAuxiliary::SetCore(CoreInterface* core)
 {
-	ci = core;
+	defaultContext.core = core;
 }
 
 void CoreAuxiliary::SetDatabaseManager(DatabaseManager* dbManager)
 {
-	dbm = dbManager;
+	defaultContext.dbm = dbManager;
+}
+
+void CoreAuxiliary::SetScriptProvider(ScriptProvider* scriptProvider)
+{
+	defaultContext.sp = scriptProvider;
+}
+
+const CoreContext* CoreAuxiliary::BoundContext()
+{
+	return boundContext;
+}
+
+std::shared_ptr<const CardPool> CoreAuxiliary::AcquirePool(const CoreContext* context)
+{
+	DatabaseManager* dbm = (context != nullptr) ? context->dbm : Current().dbm;
+	if(dbm == nullptr)
+		return nullptr;
+	return dbm->AcquirePool();
+}
+
+ScriptProvider* CoreAuxiliary::GetScriptProvider(const CoreContext* context)
+{
+	return (context != nullptr) ? context->sp : Current().sp;
+}
+
+CoreAuxiliary::Binding::Binding(const CoreContext* context, const CardPool* pool) :
+	previous(boundContext),
+	previousPool(boundPool)
+{
+	if(context != nullptr)
+		boundContext = context;
+	if(pool != nullptr)
+		boundPool = pool;
+}
+
+CoreAuxiliary::Binding::~Binding()
+{
+	boundContext = previous;
+	boundPool = previousPool;
+}
+
+void CoreAuxiliary::RegisterDuel(long pduel, CoreInterface* core)
+{
+	std::lock_guard<std::mutex> lock(duelsMutex);
+	auto range = duels.equal_range(pduel);
+	for(auto it = range.first; it != range.second; ++it)
+	{
+		if(it->second == core)
+			return;
+	}
+	duels.emplace(pduel, core);
+}
+
+void CoreAuxiliary::UnregisterDuel(long pduel, CoreInterface* core)
+{
+	std::lock_guard<std::mutex> lock(duelsMutex);
+	auto range = duels.equal_range(pduel);
+	for(auto it = range.first; it != range.second; ++it)
+	{
+		if(it->second == core)
+		{
+			duels.erase(it);
+			return;
+		}
+	}
+}
+
+unsigned char* CoreAuxiliary::CoreScriptReader(const char* scriptName, int* len)
+{
+	ScriptProvider* sp = Current().sp;
+	if(sp == nullptr)
+	{
+		Logger::Warning(LogCategory::Core, "No ScriptProvider set on CoreAuxiliary");
+		*len = 0;
+		return nullptr;
+	}
+
+	// The core parses a script before reading the next one, so holding
+	// the last one read on this thread is enough
+	static thread_local ScriptProvider::Script script;
+	return (unsigned char*)sp->ReadScript(scriptName, len, script);
 }
 
 unsigned int CoreAuxiliary::CoreCardReader(unsigned int code, CardData* cd)
 {
+	if(boundPool != nullptr)
+	{
+		DatabaseManager::ReadCoreCard(*boundPool, code, cd);
+		return 0;
+	}
+
+	DatabaseManager* dbm = Current().dbm;
 	if(dbm == nullptr)
 	{
-		puts("Warning: no DatabaseManager set on CoreAuxiliary");
+		Logger::Warning(LogCategory::Core, "No DatabaseManager set on CoreAuxiliary");
 		std::memset((void*)cd, 0, sizeof(CardData));
 		return 0;
 	}
-		
-	const CardData* wantedCard = dbm->GetCardDataByCode(code);
-	if(wantedCard == nullptr)
-		std::memset((void*)cd, 0, sizeof(CardData));
-	else
-		std::memcpy((void*)cd, (void*)wantedCard, sizeof(CardData));
+
+	dbm->ReadCoreCard(code, cd);
 	return 0;
 }
 
 unsigned int CoreAuxiliary::CoreMessageHandler(void* pduel, unsigned int msgType)
 {
+	CoreInterface* ci = Current().core;
+	{
+		// Sandboxed cores call their worker's handler, never this one
+		std::lock_guard<std::mutex> lock(duelsMutex);
+		auto range = duels.equal_range((long)pduel);
+		for(auto it = range.first; it != range.second; ++it)
+		{
+			if(!it->second->IsSandboxed())
+			{
+				ci = it->second;
+				break;
+			}
+		}
+	}
+	if(ci == nullptr)
+	{
+		Logger::Warning(LogCategory::Core, "No CoreInterface set on CoreAuxiliary");
+		return 0;
+	}
+
 	char buffer[256];
 	ci->get_log_message((long)pduel, (unsigned char*)buffer);
-	printf("Core Message (%d): %s\n", msgType, buffer);
+	Logger::Info(LogCategory::Core, "Core Message (%u): %s", msgType, buffer);
 	return 0;
 }
 
@@ -1,20 +1,69 @@
 #ifndef __CORE_AUXILIARY_HPP__
 #define __CORE_AUXILIARY_HPP__
+#include <memory>
+
 #include "card.hpp"
 
 namespace YGOpen
 {
 
+class CardPool;
 class CoreInterface;
 class DatabaseManager;
+class ScriptProvider;
 
+// Everything the core callbacks need to serve a duel
+struct CoreContext
+{
+	CoreInterface* core;
+	DatabaseManager* dbm;
+	ScriptProvider* sp;
+};
+
+// The callbacks given to the core. They serve the context bound to the
+// calling thread (see Binding), or else the default one set through the
+// static setters, so threads can run duels against different cores and
+// card pools at the same time.
 class CoreAuxiliary
 {
-	static CoreInterface* ci;
-	static DatabaseManager* dbm;
+	static CoreContext defaultContext;
+	static const CoreContext& Current();
 public:
 	static void SetCore(CoreInterface* core);
 	static void SetDatabaseManager(DatabaseManager* dbManager);
+	static void SetScriptProvider(ScriptProvider* scriptProvider);
+
+	// The context bound to the calling thread, nullptr if none is (i.e.
+	// the default one serves it), to bind it again on another thread
+	static const CoreContext* BoundContext();
+
+	// The card pool a duel created with context (or the current one if
+	// null) keeps for its whole length, nullptr without a DatabaseManager
+	static std::shared_ptr<const CardPool> AcquirePool(const CoreContext* context);
+	// The provider scripts are read from for duels created with context
+	// (or the current one if null)
+	static ScriptProvider* GetScriptProvider(const CoreContext* context);
+
+	// Binds a context to the calling thread until destroyed, bindings
+	// nest. A null context leaves the current binding as it is. Cards are
+	// read from pool if given, instead of the context's current pool.
+	class Binding
+	{
+		const CoreContext* previous;
+		const CardPool* previousPool;
+
+		Binding(const Binding&) = delete;
+		Binding& operator=(const Binding&) = delete;
+	public:
+		explicit Binding(const CoreContext* context, const CardPool* pool = nullptr);
+		~Binding();
+	};
+
+	// Lets CoreMessageHandler find the core a duel runs on from any
+	// thread, which might not be the one of the current context. Handles
+	// are only unique per core (sandboxed ones come from another process).
+	static void RegisterDuel(long pduel, CoreInterface* core);
+	static void UnregisterDuel(long pduel, CoreInterface* core);
 
 	static unsigned char* CoreScriptReader(const char* scriptName, int*);
 	static unsigned int CoreCardReader(unsigned int code, CardData* cd);
@@ -0,0 +1,148 @@
+#ifndef __CORE_CALLS__
+#define __CORE_CALLS__
+#include "core_interface.hpp"
+
+#ifdef YGOPEN_STATIC_CORE
+// The core's functions, linked into the program (premake --static-core)
+extern "C"
+{
+	void set_script_reader(YGOpen::script_reader);
+	void set_card_reader(YGOpen::card_reader);
+	void set_message_handler(YGOpen::message_handler);
+
+	long create_duel(unsigned int);
+	void start_duel(long, int);
+	void end_duel(long);
+	void set_player_info(long, int, int, int, int);
+	void get_log_message(long, unsigned char*);
+	int get_message(long, unsigned char*);
+	int process(long);
+	void new_card(long, unsigned int, unsigned char, unsigned char, unsigned char, unsigned char, unsigned char);
+	void new_tag_card(long, unsigned int, unsigned char, unsigned char);
+	void new_relay_card(long, unsigned int, unsigned char, unsigned char, unsigned char);
+	int query_card(long, unsigned char, unsigned char, unsigned char, int, unsigned char*, int);
+	int query_field_count(long, unsigned char, unsigned char);
+	int query_field_card(long, unsigned char, unsigned char, int, unsigned char*, int);
+	int query_field_info(long, unsigned char*);
+	void set_responsei(long, int);
+	void set_responseb(long, unsigned char*);
+	int preload_script(long, char*, int);
+
+	// Optional, null when the linked core does not define them. Without
+	// weak symbols (i.e. MSVC) they are never used.
+#if defined(__GNUC__)
+	__attribute__((weak)) void query_version(int*, int*, int*);
+	__attribute__((weak)) const char* query_version_string(void);
+	__attribute__((weak)) unsigned int query_capabilities(void);
+#endif
+}
+#endif
+
+namespace YGOpen
+{
+
+// Calls the functions of the core loaded by a CoreInterface
+struct DynamicCoreCalls
+{
+	static long CreateDuel(CoreInterface& core, unsigned int seed) { return core.create_duel(seed); }
+	static void StartDuel(CoreInterface& core, long pduel, int options) { core.start_duel(pduel, options); }
+	static void EndDuel(CoreInterface& core, long pduel) { core.end_duel(pduel); }
+	static void SetPlayerInfo(CoreInterface& core, long pduel, int playerID, int lp, int startCount, int drawCount)
+	{
+		core.set_player_info(pduel, playerID, lp, startCount, drawCount);
+	}
+	static void GetLogMessage(CoreInterface& core, long pduel, unsigned char* buf) { core.get_log_message(pduel, buf); }
+	static int GetMessage(CoreInterface& core, long pduel, unsigned char* buf) { return core.get_message(pduel, buf); }
+	static int Process(CoreInterface& core, long pduel) { return core.process(pduel); }
+	static void NewCard(CoreInterface& core, long pduel, unsigned int code, unsigned char owner, unsigned char playerID,
+	                    unsigned char location, unsigned char sequence, unsigned char position)
+	{
+		core.new_card(pduel, code, owner, playerID, location, sequence, position);
+	}
+	static void NewTagCard(CoreInterface& core, long pduel, unsigned int code, unsigned char owner, unsigned char location)
+	{
+		core.new_tag_card(pduel, code, owner, location);
+	}
+	static void NewRelayCard(CoreInterface& core, long pduel, unsigned int code, unsigned char owner, unsigned char location,
+	                         unsigned char playerNumber)
+	{
+		core.new_relay_card(pduel, code, owner, location, playerNumber);
+	}
+	static int QueryCard(CoreInterface& core, long pduel, unsigned char playerID, unsigned char location, unsigned char sequence,
+	                     int queryFlag, unsigned char* buf, int useCache)
+	{
+		return core.query_card(pduel, playerID, location, sequence, queryFlag, buf, useCache);
+	}
+	static int QueryFieldCount(CoreInterface& core, long pduel, unsigned char playerID, unsigned char location)
+	{
+		return core.query_field_count(pduel, playerID, location);
+	}
+	static int QueryFieldCard(CoreInterface& core, long pduel, unsigned char playerID, unsigned char location, int queryFlag,
+	                          unsigned char* buf, int useCache)
+	{
+		return core.query_field_card(pduel, playerID, location, queryFlag, buf, useCache);
+	}
+	static int QueryFieldInfo(CoreInterface& core, long pduel, unsigned char* buf) { return core.query_field_info(pduel, buf); }
+	static void SetResponsei(CoreInterface& core, long pduel, int value) { core.set_responsei(pduel, value); }
+	static void SetResponseb(CoreInterface& core, long pduel, unsigned char* buf) { core.set_responseb(pduel, buf); }
+	static int PreloadScript(CoreInterface& core, long pduel, char* script, int len) { return core.preload_script(pduel, script, len); }
+};
+
+#ifdef YGOPEN_STATIC_CORE
+// Calls the linked core directly, so the compiler can inline and
+// optimize across it (with link time optimization). The CoreInterface
+// is only there to keep the same signatures.
+struct StaticCoreCalls
+{
+	static long CreateDuel(CoreInterface&, unsigned int seed) { return ::create_duel(seed); }
+	static void StartDuel(CoreInterface&, long pduel, int options) { ::start_duel(pduel, options); }
+	static void EndDuel(CoreInterface&, long pduel) { ::end_duel(pduel); }
+	static void SetPlayerInfo(CoreInterface&, long pduel, int playerID, int lp, int startCount, int drawCount)
+	{
+		::set_player_info(pduel, playerID, lp, startCount, drawCount);
+	}
+	static void GetLogMessage(CoreInterface&, long pduel, unsigned char* buf) { ::get_log_message(pduel, buf); }
+	static int GetMessage(CoreInterface&, long pduel, unsigned char* buf) { return ::get_message(pduel, buf); }
+	static int Process(CoreInterface&, long pduel) { return ::process(pduel); }
+	static void NewCard(CoreInterface&, long pduel, unsigned int code, unsigned char owner, unsigned char playerID,
+	                    unsigned char location, unsigned char sequence, unsigned char position)
+	{
+		::new_card(pduel, code, owner, playerID, location, sequence, position);
+	}
+	static void NewTagCard(CoreInterface&, long pduel, unsigned int code, unsigned char owner, unsigned char location)
+	{
+		::new_tag_card(pduel, code, owner, location);
+	}
+	static void NewRelayCard(CoreInterface&, long pduel, unsigned int code, unsigned char owner, unsigned char location,
+	                         unsigned char playerNumber)
+	{
+		::new_relay_card(pduel, code, owner, location, playerNumber);
+	}
+	static int QueryCard(CoreInterface&, long pduel, unsigned char playerID, unsigned char location, unsigned char sequence,
+	                     int queryFlag, unsigned char* buf, int useCache)
+	{
+		return ::query_card(pduel, playerID, location, sequence, queryFlag, buf, useCache);
+	}
+	static int QueryFieldCount(CoreInterface&, long pduel, unsigned char playerID, unsigned char location)
+	{
+		return ::query_field_count(pduel, playerID, location);
+	}
+	static int QueryFieldCard(CoreInterface&, long pduel, unsigned char playerID, unsigned char location, int queryFlag,
+	                          unsigned char* buf, int useCache)
+	{
+		return ::query_field_card(pduel, playerID, location, queryFlag, buf, useCache);
+	}
+	static int QueryFieldInfo(CoreInterface&, long pduel, unsigned char* buf) { return ::query_field_info(pduel, buf); }
+	static void SetResponsei(CoreInterface&, long pduel, int value) { ::set_responsei(pduel, value); }
+	static void SetResponseb(CoreInterface&, long pduel, unsigned char* buf) { ::set_responseb(pduel, buf); }
+	static int PreloadScript(CoreInterface&, long pduel, char* script, int len) { return ::preload_script(pduel, script, len); }
+};
+
+typedef StaticCoreCalls CoreCalls;
+#else
+typedef DynamicCoreCalls CoreCalls;
+#endif
+
+} // namespace YGOpen
+
+#endif // __CORE_CALLS__
@@ -1,6 +1,16 @@
 #include "core_interface.hpp"
 
-#include <cstdio>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "core_calls.hpp"
+#include "core_sandbox.hpp"
+#include "util/logger.hpp"
 
 namespace YGOpen
 {
@@ -23,9 +33,18 @@ static const char* DEFAULT_CORE_NAME = "./libygopen-core.so";
 
 // Prototypes
 void* NativeLoadObject(const char* file);
-void* NativeLoadFunction(void* handle, const char* name);
+void* NativeLoadFunction(void* handle, const char* name, bool required);
 void  NativeUnloadObject(void* handle);
 
+// Loads a copy of file no other call shares. copyPath receives the path
+// of the copy if it has to be removed after unloading.
+void* NativeLoadIsolatedObject(const char* file, CoreIsolation isolation, std::string* copyPath);
+void  NativeRemoveCopy(const std::string& copyPath);
+// The file the loader would load for file, which copies are made from:
+// bare names are looked up along its search path, not in the working
+// directory
+bool  NativeResolveObject(const char* file, std::string* path);
+
 #ifdef _WIN32
 #include <windows.h>
 
@@ -46,21 +65,15 @@ void* NativeLoadObject(const char* file)
 
 	/* Generate an error message if all loads failed */
 	if (handle == nullptr)
-	{
-		std::string errStr = std::string("Failed loading ") + file;
-		printf(errStr.c_str());
-	}
+		Logger::Error(LogCategory::Core, "Failed loading %s", file);
 	return handle;
 }
 
-void* NativeLoadFunction(void* handle, const char* name)
+void* NativeLoadFunction(void* handle, const char* name, bool required)
 {
 	void* symbol = (void*) GetProcAddress((HMODULE) handle, name);
-	if (symbol == nullptr)
-	{
-		std::string errStr = std::string("Failed loading ") + name;
-		printf(errStr.c_str());
-	}
+	if (symbol == nullptr && required)
+		Logger::Error(LogCategory::Core, "Failed loading %s", name);
 	return symbol;
 }
 
@@ -70,8 +83,63 @@ void  NativeUnloadObject(void* handle)
 		FreeLibrary((HMODULE) handle);
 }
 
+bool  NativeResolveObject(const char* file, std::string* path)
+{
+	if(std::strchr(file, '/') != nullptr || std::strchr(file, '\\') != nullptr)
+	{
+		*path = file;
+		return true;
+	}
+	// Mapped without running any of its code, only to learn its path
+	HMODULE module = LoadLibraryExA(file, nullptr, DONT_RESOLVE_DLL_REFERENCES);
+	char buffer[MAX_PATH];
+	const DWORD length = (module != nullptr) ? GetModuleFileNameA(module, buffer, MAX_PATH) : 0;
+	if(module != nullptr)
+		FreeLibrary(module);
+	if(length == 0 || length >= MAX_PATH)
+	{
+		Logger::Error(LogCategory::Core, "Failed finding %s", file);
+		return false;
+	}
+	path->assign(buffer, length);
+	return true;
+}
+
+// Windows has no linker namespaces, every isolated core is a copy
+void* NativeLoadIsolatedObject(const char* file, CoreIsolation, std::string* copyPath)
+{
+	std::string original;
+	if(!NativeResolveObject(file, &original))
+		return nullptr;
+	static std::atomic<unsigned int> copies(0);
+	const std::string copy = original + "." + std::to_string(GetCurrentProcessId()) +
+	                         "." + std::to_string(copies++) + ".dll";
+	if(!CopyFileA(original.c_str(), copy.c_str(), FALSE))
+	{
+		Logger::Error(LogCategory::Core, "Failed copying %s to %s", original.c_str(), copy.c_str());
+		return nullptr;
+	}
+
+	// A loaded library cannot be deleted, it is removed after unloading
+	void* handle = NativeLoadObject(copy.c_str());
+	if(handle == nullptr)
+		DeleteFileA(copy.c_str());
+	else
+		*copyPath = copy;
+	return handle;
+}
+
+void  NativeRemoveCopy(const std::string& copyPath)
+{
+	DeleteFileA(copyPath.c_str());
+}
+
 #else
+#include <climits>
 #include <dlfcn.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdlib>
 
 void* NativeLoadObject(const char* file)
 {
@@ -90,12 +158,12 @@ void* NativeLoadObject(const char* file)
 	handle = dlopen(file, RTLD_NOW|RTLD_LOCAL);
 	loaderror = (char*)dlerror();
 	if (handle == nullptr)
-		printf("Failed loading %s: %s", file, loaderror);
+		Logger::Error(LogCategory::Core, "Failed loading %s: %s", file, loaderror);
 
 	return (handle);
 }
 
-void* NativeLoadFunction(void* handle, const char* name)
+void* NativeLoadFunction(void* handle, const char* name, bool required)
 {
 	void* symbol = dlsym(handle, name);
 	if (symbol == nullptr)
@@ -103,8 +171,8 @@ void* NativeLoadFunction(void* handle, const char* name)
 		/* append an underscore for platforms that need that. */
 		std::string _name = std::string("_") + name;
 		symbol = dlsym(handle, _name.c_str());
-		if (symbol == nullptr)
-			printf("Failed loading %s: %s", name, (const char*)dlerror());
+		if (symbol == nullptr && required)
+			Logger::Error(LogCategory::Core, "Failed loading %s: %s", name, (const char*)dlerror());
 	}
 	return (symbol);
 }
@@ -114,21 +182,370 @@ void NativeUnloadObject(void* handle)
 	if (handle != nullptr)
 		dlclose(handle);
 }
+
+bool  NativeResolveObject(const char* file, std::string* path)
+{
+	if(std::strchr(file, '/') != nullptr)
+	{
+		*path = file;
+		return true;
+	}
+#ifdef LM_ID_NEWLM
+	// The directory the loader found it in
+	void* handle = dlopen(file, RTLD_LAZY|RTLD_LOCAL);
+	char origin[PATH_MAX];
+	if(handle != nullptr && dlinfo(handle, RTLD_DI_ORIGIN, origin) == 0)
+		*path = std::string(origin) + "/" + file;
+	if(handle != nullptr)
+		dlclose(handle);
+	if(!path->empty())
+		return true;
+#endif
+	Logger::Error(LogCategory::Core, "Failed finding %s, give its path to load a copy of it", file);
+	return false;
+}
+
+void* NativeLoadIsolatedObject(const char* file, CoreIsolation isolation, std::string*)
+{
+#ifdef LM_ID_NEWLM
+	if(isolation == CoreIsolation::Namespace)
+	{
+		void* handle = dlmopen(LM_ID_NEWLM, file, RTLD_NOW|RTLD_LOCAL);
+		if(handle != nullptr)
+			return handle;
+		// Namespaces are a scarce resource (16 with glibc)
+		Logger::Warning(LogCategory::Core, "Failed loading %s in a new namespace: %s. Loading a copy instead",
+		                file, (const char*)dlerror());
+	}
+#else
+	(void)isolation;
+#endif
+
+	std::string original;
+	if(!NativeResolveObject(file, &original))
+		return nullptr;
+	// Copied next to the original, temporary directories might be noexec
+	std::string copy = original + ".XXXXXX";
+	const int out = mkstemp(&copy[0]);
+	if(out < 0)
+	{
+		Logger::Error(LogCategory::Core, "Failed creating a copy of %s", original.c_str());
+		return nullptr;
+	}
+	const int in = open(original.c_str(), O_RDONLY);
+	bool copied = (in >= 0);
+	char buffer[65536];
+	ssize_t bytes;
+	while(copied && (bytes = read(in, buffer, sizeof(buffer))) > 0)
+		copied = (write(out, buffer, (size_t)bytes) == bytes);
+	if(in >= 0)
+		close(in);
+	copied = (close(out) == 0) && copied;
+
+	void* handle = copied ? NativeLoadObject(copy.c_str()) : nullptr;
+	if(!copied)
+		Logger::Error(LogCategory::Core, "Failed copying %s to %s", original.c_str(), copy.c_str());
+	// The mapping keeps the library alive, the file is not needed anymore
+	unlink(copy.c_str());
+	return handle;
+}
+
+void NativeRemoveCopy(const std::string&)
+{}
+#endif
+
+// Instrumentation. Plain function pointers cannot carry state, so each
+// instrumented core takes one of PROBE_SLOTS slots and its functions are
+// replaced by probes instantiated for that slot, which find the real
+// functions and the counters through it.
+static const int PROBE_SLOTS = 16;
+static const std::size_t FUNCTION_COUNT = (std::size_t)CoreFunction::Count;
+
+static const char* const FUNCTION_NAMES[FUNCTION_COUNT] =
+{
+	"set_script_reader",
+	"set_card_reader",
+	"set_message_handler",
+	"create_duel",
+	"start_duel",
+	"end_duel",
+	"set_player_info",
+	"get_log_message",
+	"get_message",
+	"process",
+	"new_card",
+	"new_tag_card",
+	"new_relay_card",
+	"query_card",
+	"query_field_count",
+	"query_field_card",
+	"query_field_info",
+	"set_responsei",
+	"set_responseb",
+	"preload_script",
+};
+
+static void* realFunctions[PROBE_SLOTS][FUNCTION_COUNT];
+static std::atomic<uint32_t> usedSlots(0);
+static std::atomic<unsigned int> slotGeneration[PROBE_SLOTS];
+
+// Only written by the owning thread, atomics so other threads can read them
+struct ProbeCounter
+{
+	std::atomic<unsigned long long> calls;
+	std::atomic<unsigned long long> totalNanoseconds;
+	std::atomic<unsigned long long> maxNanoseconds;
+	std::atomic<unsigned long long> bytes;
+};
+
+struct ProbeCounters
+{
+	std::atomic<unsigned int> generation[PROBE_SLOTS]; // Counters from older cores are stale
+	ProbeCounter counters[PROBE_SLOTS][FUNCTION_COUNT];
+};
+
+// Counters of every thread that called an instrumented core. They are
+// kept after the thread exits so its calls still count.
+static std::mutex countersMutex;
+static std::vector<std::unique_ptr<ProbeCounters>> allCounters;
+static thread_local ProbeCounters* threadCounters = nullptr;
+
+static inline void Bump(std::atomic<unsigned long long>& counter, unsigned long long value)
+{
+	counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+static void RecordCall(int slot, CoreFunction function, unsigned long long ns, unsigned long long bytes)
+{
+	if(threadCounters == nullptr)
+	{
+		std::unique_ptr<ProbeCounters> counters(new ProbeCounters()); // Zeroed
+		threadCounters = counters.get();
+		std::lock_guard<std::mutex> lock(countersMutex);
+		allCounters.push_back(std::move(counters));
+	}
+
+	const unsigned int generation = slotGeneration[slot].load(std::memory_order_relaxed);
+	ProbeCounter* counters = threadCounters->counters[slot];
+	if(threadCounters->generation[slot].load(std::memory_order_relaxed) != generation)
+	{
+		for(std::size_t i = 0; i < FUNCTION_COUNT; ++i)
+		{
+			counters[i].calls.store(0, std::memory_order_relaxed);
+			counters[i].totalNanoseconds.store(0, std::memory_order_relaxed);
+			counters[i].maxNanoseconds.store(0, std::memory_order_relaxed);
+			counters[i].bytes.store(0, std::memory_order_relaxed);
+		}
+		threadCounters->generation[slot].store(generation, std::memory_order_release);
+	}
+
+	ProbeCounter& counter = counters[(std::size_t)function];
+	Bump(counter.calls, 1);
+	Bump(counter.totalNanoseconds, ns);
+	Bump(counter.bytes, bytes);
+	if(ns > counter.maxNanoseconds.load(std::memory_order_relaxed))
+		counter.maxNanoseconds.store(ns, std::memory_order_relaxed);
+}
+
+// Size of the buffer filled by the call, for the functions that fill one
+template<typename R>
+static inline unsigned long long ReturnedBytes(CoreFunction, R)
+{
+	return 0;
+}
+
+static inline unsigned long long ReturnedBytes(CoreFunction function, int result)
+{
+	switch(function)
+	{
+		case CoreFunction::Process:
+			return (unsigned int)result & 0xFFFF;
+		case CoreFunction::GetMessage:
+		case CoreFunction::QueryCard:
+		case CoreFunction::QueryFieldCard:
+		case CoreFunction::QueryFieldInfo:
+			return (result > 0) ? (unsigned long long)result : 0;
+		default:
+			return 0;
+	}
+}
+
+class ProbeTimer
+{
+	int slot;
+	CoreFunction function;
+	std::chrono::steady_clock::time_point start;
+public:
+	ProbeTimer(int slot, CoreFunction function) :
+		slot(slot),
+		function(function),
+		start(std::chrono::steady_clock::now())
+	{}
+
+	void Stop(unsigned long long bytes)
+	{
+		const auto elapsed = std::chrono::steady_clock::now() - start;
+		RecordCall(slot, function, (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(), bytes);
+	}
+};
+
+template<int Slot, CoreFunction Function, typename F>
+struct Probe;
+
+template<int Slot, CoreFunction Function, typename R, typename... Args>
+struct Probe<Slot, Function, R (*)(Args...)>
+{
+	static R Call(Args... args)
+	{
+		R (*real)(Args...) = (R (*)(Args...))realFunctions[Slot][(std::size_t)Function];
+		ProbeTimer timer(Slot, Function);
+		R result = real(args...);
+		timer.Stop(ReturnedBytes(Function, result));
+		return result;
+	}
+};
+
+template<int Slot, CoreFunction Function, typename... Args>
+struct Probe<Slot, Function, void (*)(Args...)>
+{
+	static void Call(Args... args)
+	{
+		void (*real)(Args...) = (void (*)(Args...))realFunctions[Slot][(std::size_t)Function];
+		ProbeTimer timer(Slot, Function);
+		real(args...);
+		timer.Stop(0);
+	}
+};
+
+template<int Slot>
+static void InstallProbes(CoreInterface& ci)
+{
+#define PROBE(x, f) \
+	realFunctions[Slot][(std::size_t)CoreFunction::f] = (void*)ci.x; \
+	ci.x = &Probe<Slot, CoreFunction::f, decltype(ci.x)>::Call;
+
+	PROBE(set_script_reader, SetScriptReader)
+	PROBE(set_card_reader, SetCardReader)
+	PROBE(set_message_handler, SetMessageHandler)
+	PROBE(create_duel, CreateDuel)
+	PROBE(start_duel, StartDuel)
+	PROBE(end_duel, EndDuel)
+	PROBE(set_player_info, SetPlayerInfo)
+	PROBE(get_log_message, GetLogMessage)
+	PROBE(get_message, GetMessage)
+	PROBE(process, Process)
+	PROBE(new_card, NewCard)
+	PROBE(new_tag_card, NewTagCard)
+	PROBE(new_relay_card, NewRelayCard)
+	PROBE(query_card, QueryCard)
+	PROBE(query_field_count, QueryFieldCount)
+	PROBE(query_field_card, QueryFieldCard)
+	PROBE(query_field_info, QueryFieldInfo)
+	PROBE(set_responsei, SetResponsei)
+	PROBE(set_responseb, SetResponseb)
+	PROBE(preload_script, PreloadScript)
+
+#undef PROBE
+}
+
+static int AcquireProbeSlot()
+{
+	uint32_t used = usedSlots.load();
+	for(int slot = 0; slot < PROBE_SLOTS; ++slot)
+	{
+		const uint32_t bit = 1u << slot;
+		if(used & bit)
+			continue;
+		if(usedSlots.compare_exchange_strong(used, used | bit))
+		{
+			slotGeneration[slot].fetch_add(1);
+			return slot;
+		}
+		slot = -1; // used was reloaded, start over
+	}
+	return -1;
+}
+
+static void ReleaseProbeSlot(int slot)
+{
+	usedSlots.fetch_and(~(1u << slot));
+}
+
+static void InstallProbes(CoreInterface& ci, int slot)
+{
+	switch(slot)
+	{
+		case 0: InstallProbes<0>(ci); break;
+		case 1: InstallProbes<1>(ci); break;
+		case 2: InstallProbes<2>(ci); break;
+		case 3: InstallProbes<3>(ci); break;
+		case 4: InstallProbes<4>(ci); break;
+		case 5: InstallProbes<5>(ci); break;
+		case 6: InstallProbes<6>(ci); break;
+		case 7: InstallProbes<7>(ci); break;
+		case 8: InstallProbes<8>(ci); break;
+		case 9: InstallProbes<9>(ci); break;
+		case 10: InstallProbes<10>(ci); break;
+		case 11: InstallProbes<11>(ci); break;
+		case 12: InstallProbes<12>(ci); break;
+		case 13: InstallProbes<13>(ci); break;
+		case 14: InstallProbes<14>(ci); break;
+		case 15: InstallProbes<15>(ci); break;
+	}
+}
+
+#ifdef YGOPEN_STATIC_CORE
+static void BindLinkedCore(CoreInterface& ci)
+{
+	ci.set_script_reader = &::set_script_reader;
+	ci.set_card_reader = &::set_card_reader;
+	ci.set_message_handler = &::set_message_handler;
+	ci.create_duel = &::create_duel;
+	ci.start_duel = &::start_duel;
+	ci.end_duel = &::end_duel;
+	ci.set_player_info = &::set_player_info;
+	ci.get_log_message = &::get_log_message;
+	ci.get_message = &::get_message;
+	ci.process = &::process;
+	ci.new_card = &::new_card;
+	ci.new_tag_card = &::new_tag_card;
+	ci.new_relay_card = &::new_relay_card;
+	ci.query_card = &::query_card;
+	ci.query_field_count = &::query_field_count;
+	ci.query_field_card = &::query_field_card;
+	ci.query_field_info = &::query_field_info;
+	ci.set_responsei = &::set_responsei;
+	ci.set_responseb = &::set_responseb;
+	ci.preload_script = &::preload_script;
+#if defined(__GNUC__)
+	ci.query_version = &::query_version;
+	ci.query_version_string = &::query_version_string;
+	ci.query_capabilities = &::query_capabilities;
+#endif
+}
 #endif
 
 template<typename T>
 T CoreInterface::LoadFunction(void* handle, T* func, const char* name, bool unload)
 {
-	*func = (T)NativeLoadFunction(handle, name);
+	*func = (T)NativeLoadFunction(handle, name, unload);
 	if(*func == nullptr && unload)
 		UnloadCore();
 
 	return *func;
 }
 
-CoreInterface::CoreInterface(bool loadCore) :
+CoreInterface::CoreInterface(bool loadCore, CoreIsolation isolation) :
 	activeCorePath(""),
-	handle(nullptr)
+	isolation(isolation),
+	handle(nullptr),
+	instrumented(false),
+	probeSlot(-1),
+	capabilities(0),
+	sandbox(nullptr),
+	query_version(nullptr),
+	query_version_string(nullptr),
+	query_capabilities(nullptr)
 {
 	if(loadCore)
 		LoadCore();
@@ -140,7 +557,14 @@ bool CoreInterface::LoadCore(const char* path)
 
 	std::string usedPath = path;
 
-	handle = NativeLoadObject(usedPath.c_str());
+#ifdef YGOPEN_STATIC_CORE
+	// Linked in, there is nothing to load
+	BindLinkedCore(*this);
+#else
+	if(isolation == CoreIsolation::Shared)
+		handle = NativeLoadObject(usedPath.c_str());
+	else
+		handle = NativeLoadIsolatedObject(usedPath.c_str(), isolation, &copyPath);
 	/* TODO: get current working directory without SDL
 	if(handle == nullptr)
 	{
@@ -181,10 +605,98 @@ bool CoreInterface::LoadCore(const char* path)
 
 #undef LF
 
+	// Optional functions, newer cores advertise what they can do through them
+	LoadFunction(handle, &query_version, "query_version", false);
+	LoadFunction(handle, &query_version_string, "query_version_string", false);
+	LoadFunction(handle, &query_capabilities, "query_capabilities", false);
+#endif
+
+	capabilities = 0;
+	if(query_version != nullptr)
+		capabilities |= (unsigned int)CoreCapability::QueryVersion;
+	if(query_version_string != nullptr)
+		capabilities |= (unsigned int)CoreCapability::QueryVersionString;
+	if(query_capabilities != nullptr)
+		capabilities |= query_capabilities() & CORE_ADVERTISED_CAPABILITIES;
+
+#ifdef YGOPEN_STATIC_CORE
+	// Duel calls the linked core directly, the probes would not see it
+	if(instrumented)
+		Logger::Warning(LogCategory::Core, "Linked cores cannot be instrumented");
+#else
+	if(instrumented)
+	{
+		probeSlot = AcquireProbeSlot();
+		if(probeSlot < 0)
+			Logger::Warning(LogCategory::Core, "Too many instrumented cores, %s is loaded without instrumentation", usedPath);
+		else
+			InstallProbes(*this, probeSlot);
+	}
+#endif
+
 	activeCorePath = usedPath; 
 	return true;
 }
 
+bool CoreInterface::LoadCore(CoreSandbox& sandbox)
+{
+	UnloadCore();
+#ifdef YGOPEN_STATIC_CORE
+	// Duel would call the linked core instead of the sandbox
+	Logger::Error(LogCategory::Core, "Sandboxed cores cannot be used with a linked core");
+	(void)sandbox;
+	return false;
+#endif
+	if(!sandbox.IsAlive())
+	{
+		Logger::Error(LogCategory::Core, "Core sandbox is not running");
+		return false;
+	}
+
+	sandbox.Bind(*this);
+	this->sandbox = &sandbox;
+	// Reported by the worker, the optional functions stay in there
+	capabilities = sandbox.GetCapabilities();
+
+	if(instrumented)
+	{
+		probeSlot = AcquireProbeSlot();
+		if(probeSlot < 0)
+			Logger::Warning(LogCategory::Core, "Too many instrumented cores, sandboxed core is loaded without instrumentation");
+		else
+			InstallProbes(*this, probeSlot);
+	}
+	return true;
+}
+
+bool CoreInterface::HasCapability(CoreCapability capability) const
+{
+	return (capabilities & (unsigned int)capability) != 0;
+}
+
+unsigned int CoreInterface::GetCapabilities() const
+{
+	return capabilities;
+}
+
+std::string CoreInterface::GetVersion() const
+{
+	if(sandbox != nullptr)
+		return sandbox->GetVersion();
+	if(query_version_string != nullptr)
+	{
+		const char* version = query_version_string();
+		return (version != nullptr) ? version : "";
+	}
+	if(query_version != nullptr)
+	{
+		int major = 0, minor = 0, patch = 0;
+		query_version(&major, &minor, &patch);
+		return std::to_string(major) + "." + std::to_string(minor) + "." + std::to_string(patch);
+	}
+	return "";
+}
+
 bool CoreInterface::LoadCore()
 {
 	return LoadCore(DEFAULT_CORE_NAME);
@@ -192,21 +704,83 @@ bool CoreInterface::LoadCore()
 
 bool CoreInterface::ReloadCore()
 {
-	if(handle)
+	if(sandbox != nullptr)
+	{
+		Logger::Warning(LogCategory::Core, "Sandboxed cores are reloaded by restarting their worker");
+		return false;
+	}
+	if(IsLibraryLoaded())
 	{
 		std::string corePath = activeCorePath;
 		UnloadCore();
 		return LoadCore(corePath.c_str());
 	}
 
-	puts("Core was not initially loaded. Reload is not possible");
+	Logger::Warning(LogCategory::Core, "Core was not initially loaded. Reload is not possible");
 
 	return false;
 }
 
 bool CoreInterface::IsLibraryLoaded()
 {
-	return (bool)handle;
+#ifdef YGOPEN_STATIC_CORE
+	if(!activeCorePath.empty())
+		return true;
+#endif
+	return (bool)handle || sandbox != nullptr;
+}
+
+bool CoreInterface::IsAlive() const
+{
+	return sandbox == nullptr || sandbox->IsAlive();
+}
+
+bool CoreInterface::IsSandboxed() const
+{
+	return sandbox != nullptr;
+}
+
+bool CoreInterface::HasFailed() const
+{
+	return sandbox != nullptr && sandbox->HasFailed();
+}
+
+void CoreInterface::SetInstrumented(bool enable)
+{
+	instrumented = enable;
+}
+
+bool CoreInterface::IsInstrumented() const
+{
+	return probeSlot >= 0;
+}
+
+CoreCallStats CoreInterface::GetCallStats(CoreFunction function) const
+{
+	CoreCallStats stats = {0, 0, 0, 0};
+	if(probeSlot < 0)
+		return stats;
+
+	const unsigned int generation = slotGeneration[probeSlot].load(std::memory_order_relaxed);
+	std::lock_guard<std::mutex> lock(countersMutex);
+	for(auto& counters : allCounters)
+	{
+		if(counters->generation[probeSlot].load(std::memory_order_acquire) != generation)
+			continue;
+		const ProbeCounter& counter = counters->counters[probeSlot][(std::size_t)function];
+		stats.calls += counter.calls.load(std::memory_order_relaxed);
+		stats.totalNanoseconds += counter.totalNanoseconds.load(std::memory_order_relaxed);
+		stats.bytes += counter.bytes.load(std::memory_order_relaxed);
+		const unsigned long long max = counter.maxNanoseconds.load(std::memory_order_relaxed);
+		if(max > stats.maxNanoseconds)
+			stats.maxNanoseconds = max;
+	}
+	return stats;
+}
+
+const char* CoreInterface::GetFunctionName(CoreFunction function)
+{
+	return FUNCTION_NAMES[(std::size_t)function];
 }
 
 CoreInterface::~CoreInterface()
@@ -220,6 +794,17 @@ void CoreInterface::UnloadCore()
 		NativeUnloadObject(handle);
 	handle = nullptr;
 	activeCorePath = "";
+	if(probeSlot >= 0)
+		ReleaseProbeSlot(probeSlot);
+	probeSlot = -1;
+	capabilities = 0;
+	sandbox = nullptr;
+	query_version = nullptr;
+	query_version_string = nullptr;
+	query_capabilities = nullptr;
+	if(!copyPath.empty())
+		NativeRemoveCopy(copyPath);
+	copyPath.clear();
 }
 
 } // namespace YGOpen
@@ -7,6 +7,67 @@
 namespace YGOpen
 {
 
+class CoreSandbox;
+
+// How a core library is loaded. A Shared core is the same library, with
+// the same globals and callbacks, for every CoreInterface loading it.
+// The other modes give each CoreInterface a copy of its own, so worker
+// threads can drive one each without any state in common.
+enum class CoreIsolation
+{
+	Shared,
+	Namespace, // In a new linker namespace (dlmopen), else like Copy
+	Copy, // From a private copy of the library file
+};
+
+// Every function loaded from the core, in the order they are loaded
+enum class CoreFunction
+{
+	SetScriptReader,
+	SetCardReader,
+	SetMessageHandler,
+	CreateDuel,
+	StartDuel,
+	EndDuel,
+	SetPlayerInfo,
+	GetLogMessage,
+	GetMessage,
+	Process,
+	NewCard,
+	NewTagCard,
+	NewRelayCard,
+	QueryCard,
+	QueryFieldCount,
+	QueryFieldCard,
+	QueryFieldInfo,
+	SetResponsei,
+	SetResponseb,
+	PreloadScript,
+	Count
+};
+
+// Calls made to one core function, over every thread
+struct CoreCallStats
+{
+	unsigned long long calls;
+	unsigned long long totalNanoseconds;
+	unsigned long long maxNanoseconds;
+	unsigned long long bytes; // Returned by the message and query functions
+};
+
+// Things a core can do besides the functions every core has. The first
+// ones depend on optional functions being exported, the rest are
+// advertised by the core through query_capabilities.
+enum class CoreCapability : unsigned int
+{
+	QueryVersion = 1 << 0, // query_version is exported
+	QueryVersionString = 1 << 1, // query_version_string is exported
+	MessageLength = 1 << 8, // get_message returns the length of the messages it copied
+};
+
+// The capabilities a core can claim through query_capabilities
+static const unsigned int CORE_ADVERTISED_CAPABILITIES = ~0xFFu;
+
 typedef unsigned char* (*script_reader)(const char*, int*);
 typedef unsigned int (*card_reader)(unsigned int, CardData*);
 typedef unsigned int (*message_handler)(void*, unsigned int);
@@ -14,18 +75,54 @@ typedef unsigned int (*message_handler)(void*, unsigned int);
 class CoreInterface
 {
 	std::string activeCorePath;
+	CoreIsolation isolation;
+	std::string copyPath; // Removed once unloaded, if any
 	void* handle;
+	bool instrumented;
+	int probeSlot; // -1 if the loaded functions are not instrumented
+	unsigned int capabilities;
+	CoreSandbox* sandbox; // Running the core, if it is not loaded in process
 
 	template<typename T>
 	T LoadFunction(void* handle, T* func, const char* name, bool unload);
 public:
 	// Core loading
-	CoreInterface(bool Loadlibrary);
+	CoreInterface(bool Loadlibrary, CoreIsolation isolation = CoreIsolation::Shared);
+	// In builds with the core linked in (YGOPEN_STATIC_CORE) this binds
+	// the linked functions instead, path and isolation are ignored
 	bool LoadCore(const char* path);
 	bool LoadCore();
+	// Forwards every call to the core running in sandbox's worker, which
+	// must outlive the CoreInterface or be unloaded from it first
+	bool LoadCore(CoreSandbox& sandbox);
+	// Any duel still running on the core must have ended, see CoreManager
 	bool ReloadCore();
 
 	bool IsLibraryLoaded();
+	// False once a sandboxed core's worker is gone, every call then
+	// returns zero. Cores loaded in process are always alive.
+	bool IsAlive() const;
+	// Loaded from a CoreSandbox
+	bool IsSandboxed() const;
+	// Whether a call already found the worker of a sandboxed core gone,
+	// without checking on it, e.g. after a call returned zero
+	bool HasFailed() const;
+
+	// Cores loaded while instrumented have every function wrapped to
+	// count calls, time them and sum the bytes returned, in per-thread
+	// counters. Otherwise calls go straight to the core. A limited number
+	// of cores can be instrumented at once, others load uninstrumented.
+	void SetInstrumented(bool enable);
+	bool IsInstrumented() const;
+	// Calls made since the core was loaded, all zero if not instrumented
+	CoreCallStats GetCallStats(CoreFunction function) const;
+	static const char* GetFunctionName(CoreFunction function);
+
+	// What the loaded core supports, see CoreCapability
+	bool HasCapability(CoreCapability capability) const;
+	unsigned int GetCapabilities() const;
+	// As reported by the core, empty if it does not say
+	std::string GetVersion() const;
 
 	// Core functions
 	void (*set_script_reader)(script_reader);
@@ -50,9 +147,10 @@ public:
 	void (*set_responseb)(long, unsigned char*);
 	int (*preload_script)(long, char*, int);
 
-	// Core extension functions
-	//void (*query_version)(int*, int*, int*);
-	//const char* (*query_version_string)(void);
+	// Core extension functions, nullptr if the core does not export them
+	void (*query_version)(int*, int*, int*);
+	const char* (*query_version_string)(void);
+	unsigned int (*query_capabilities)(void);
 
 	// Core unloading
 	~CoreInterface();
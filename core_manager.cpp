@@ -0,0 +1,54 @@
+#include "core_manager.hpp"
+#include <algorithm>
+
+#include "core_auxiliary.hpp"
+#include "util/logger.hpp"
+
+namespace YGOpen
+{
+
+CoreManager::CoreManager(CoreIsolation isolation) :
+	isolation(isolation),
+	version(0)
+{}
+
+bool CoreManager::LoadCore(const char* path)
+{
+	std::lock_guard<std::mutex> lock(writeMutex);
+	std::shared_ptr<CoreInterface> next = std::make_shared<CoreInterface>(false, isolation);
+	if(!next->LoadCore(path))
+		return false;
+
+	next->set_script_reader(&CoreAuxiliary::CoreScriptReader);
+	next->set_card_reader(&CoreAuxiliary::CoreCardReader);
+	next->set_message_handler(&CoreAuxiliary::CoreMessageHandler);
+
+	std::shared_ptr<CoreInterface> old = core;
+	std::atomic_store(&core, next);
+	const unsigned int loaded = ++version;
+	if(old)
+		retiredCores.push_back(old);
+	Logger::Info(LogCategory::Core, "Loaded core version %u from %s", loaded, path);
+	return true;
+}
+
+std::shared_ptr<CoreInterface> CoreManager::AcquireCore() const
+{
+	return std::atomic_load(&core);
+}
+
+unsigned int CoreManager::GetVersion() const
+{
+	return version;
+}
+
+std::size_t CoreManager::DrainingCores()
+{
+	std::lock_guard<std::mutex> lock(writeMutex);
+	retiredCores.erase(std::remove_if(retiredCores.begin(), retiredCores.end(),
+	                   [](const std::weak_ptr<CoreInterface>& old) { return old.expired(); }),
+	                   retiredCores.end());
+	return retiredCores.size();
+}
+
+} // namespace YGOpen
@@ -0,0 +1,51 @@
+#ifndef __CORE_MANAGER__
+#define __CORE_MANAGER__
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "core_interface.hpp"
+
+namespace YGOpen
+{
+
+// Owns the current version of the core. Loading a new version does not
+// touch the running duels: new duels get the new version through
+// AcquireCore, while every Duel holds on to the one it was created with,
+// which is unloaded once the last of them ends.
+//
+// Versions are loaded isolated (see CoreIsolation), as loading the same
+// path twice would otherwise just return the library already loaded.
+// The CoreAuxiliary callbacks are set on every version loaded.
+class CoreManager
+{
+	CoreIsolation isolation;
+
+	std::mutex writeMutex; // Serializes loads
+	std::shared_ptr<CoreInterface> core;
+	std::atomic<unsigned int> version;
+	std::vector<std::weak_ptr<CoreInterface>> retiredCores;
+
+	CoreManager(const CoreManager&) = delete;
+	CoreManager& operator=(const CoreManager&) = delete;
+public:
+	explicit CoreManager(CoreIsolation isolation = CoreIsolation::Copy);
+
+	// Loads a new version and makes it current, the current one is kept
+	// if it fails to load
+	bool LoadCore(const char* path);
+
+	// The current version, nullptr if none is loaded. Stays loaded for as
+	// long as it is held. See Duel::Create to start a duel with it.
+	std::shared_ptr<CoreInterface> AcquireCore() const;
+	// How many versions were loaded so far
+	unsigned int GetVersion() const;
+	// How many replaced versions are still loaded, i.e. used by a duel
+	std::size_t DrainingCores();
+};
+
+} // namespace YGOpen
+
+#endif // __CORE_MANAGER__
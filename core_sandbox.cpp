@@ -0,0 +1,850 @@
+#include "core_sandbox.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <new>
+#include <thread>
+
+#include "core_interface.hpp"
+#include "util/logger.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <csignal>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+extern char** environ;
+#endif
+#ifdef __linux__
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace YGOpen
+{
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "Atomics in shared memory must be lock free");
+
+static const char SANDBOX_MAGIC[8] = "YGOSBX";
+static const uint32_t SANDBOX_VERSION = 2;
+static const std::size_t CHANNEL_COUNT = 32; // Calls in flight at once
+static const std::size_t CHANNEL_DATA_SIZE = 0x10000;
+static const std::size_t CHANNEL_ARGS = 8;
+static const std::size_t RESPONSE_SIZE = 64; // Copied by set_responseb
+// Buffers the host gives the core to write to
+static const std::size_t MESSAGE_SIZE = 4096; // See DUEL_BUFFER_SIZE
+static const std::size_t LOG_MESSAGE_SIZE = 256; // See CoreAuxiliary::CoreMessageHandler
+static const std::size_t VERSION_SIZE = 64;
+
+// SandboxHeader::workerState
+static const uint32_t WORKER_STARTING = 0;
+static const uint32_t WORKER_READY = 1;
+static const uint32_t WORKER_STOPPED = 2;
+
+// SandboxChannel::state
+static const uint32_t CHANNEL_FREE = 0;
+static const uint32_t CHANNEL_BUSY = 1; // Being filled by a host thread
+static const uint32_t CHANNEL_REQUEST = 2;
+static const uint32_t CHANNEL_RESPONSE = 3;
+
+struct alignas(64) SandboxHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t channelCount;
+	std::atomic<uint32_t> workerState;
+	std::atomic<uint32_t> stop;
+	// Set while the worker is about to block, the host then bumps wakeups
+	// and wakes it (see WakeWorker)
+	std::atomic<uint32_t> workerSleeping;
+	std::atomic<uint32_t> wakeups;
+	uint64_t hostPid;
+	// Written by the worker before it is Ready
+	uint32_t capabilities;
+	char coreVersion[VERSION_SIZE];
+};
+
+// One call at a time: a host thread takes a free channel, fills it and
+// posts the request, the worker posts the response back in place
+struct alignas(64) SandboxChannel
+{
+	std::atomic<uint32_t> state;
+	uint32_t function;
+	int64_t args[CHANNEL_ARGS];
+	int64_t result;
+	uint32_t size; // Bytes of data used, in either direction
+	unsigned char data[CHANNEL_DATA_SIZE];
+};
+
+struct SandboxMemory
+{
+	SandboxHeader header;
+	SandboxChannel channels[CHANNEL_COUNT];
+};
+
+static inline void CpuRelax()
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	_mm_pause();
+#elif defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#endif
+}
+
+// Both sides spin this many times before yielding, a call answered
+// within the spin costs no system call at all. On a single processor
+// spinning only delays the other side, they yield right away.
+static const unsigned int SPIN_COUNT = 4000;
+static const unsigned int YIELD_COUNT = 2000;
+// Idle workers then block, first for WORKER_SLEEP and twice as long
+// every time after. Where the host cannot wake them (see WakeWorker) the
+// longest wait is also how late a call after a long pause can be.
+static const std::chrono::microseconds WORKER_SLEEP(50);
+#ifdef __linux__
+static const std::chrono::microseconds WORKER_SLEEP_MAX(200000);
+#else
+static const std::chrono::microseconds WORKER_SLEEP_MAX(10000);
+#endif
+// How often a waiting host checks whether the worker is gone, idle
+// workers check on the host every time they wake up
+static const unsigned int CHECK_INTERVAL = 1024;
+
+static unsigned int SpinCount()
+{
+	static const unsigned int count = (std::thread::hardware_concurrency() == 1) ? 0 : SPIN_COUNT;
+	return count;
+}
+
+// Waits until wakeups is no longer seen or timeout passes. Only Linux
+// can wait on memory shared between processes without a named kernel
+// object, elsewhere this just sleeps.
+static void WaitForWakeup(SandboxHeader& header, uint32_t seen, std::chrono::microseconds timeout)
+{
+#ifdef __linux__
+	struct timespec ts;
+	ts.tv_sec = (time_t)(timeout.count() / 1000000);
+	ts.tv_nsec = (long)(timeout.count() % 1000000) * 1000;
+	syscall(SYS_futex, (uint32_t*)&header.wakeups, FUTEX_WAIT, seen, &ts, nullptr, 0);
+#else
+	(void)header;
+	(void)seen;
+	std::this_thread::sleep_for(timeout);
+#endif
+}
+
+// Wakes the worker if it is blocked in WaitForWakeup. Whatever was
+// stored before (sequentially consistent) is seen by the worker.
+static void WakeWorker(SandboxHeader& header)
+{
+	if(header.workerSleeping.load() == 0)
+		return;
+	header.wakeups.fetch_add(1);
+#ifdef __linux__
+	syscall(SYS_futex, (uint32_t*)&header.wakeups, FUTEX_WAKE, 1, nullptr, nullptr, 0);
+#endif
+}
+
+// Plain function pointers cannot carry state, so each sandbox takes one
+// of STUB_SLOTS slots and CoreInterface functions are replaced by stubs
+// instantiated for that slot, which find the sandbox through it.
+static const int STUB_SLOTS = 16;
+static CoreSandbox* sandboxes[STUB_SLOTS];
+static std::atomic<uint32_t> usedSlots(0);
+
+static int AcquireStubSlot()
+{
+	uint32_t used = usedSlots.load();
+	for(int slot = 0; slot < STUB_SLOTS; ++slot)
+	{
+		const uint32_t bit = 1u << slot;
+		if(used & bit)
+			continue;
+		if(usedSlots.compare_exchange_strong(used, used | bit))
+			return slot;
+		slot = -1; // used was reloaded, start over
+	}
+	return -1;
+}
+
+static void ReleaseStubSlot(int slot)
+{
+	usedSlots.fetch_and(~(1u << slot));
+}
+
+template<int Slot>
+struct RemoteStubs
+{
+	static long long Call(CoreFunction function, std::initializer_list<long long> args,
+	                      const void* in = nullptr, std::size_t inSize = 0,
+	                      void* out = nullptr, std::size_t outSize = 0)
+	{
+		return sandboxes[Slot]->Call(function, args.begin(), args.size(), in, inSize, out, outSize);
+	}
+
+	// The worker uses its own readers and handler
+	static void SetScriptReader(script_reader) {}
+	static void SetCardReader(card_reader) {}
+	static void SetMessageHandler(message_handler) {}
+
+	static long CreateDuel(unsigned int seed)
+	{
+		return (long)Call(CoreFunction::CreateDuel, {seed});
+	}
+	static void StartDuel(long pduel, int options)
+	{
+		Call(CoreFunction::StartDuel, {pduel, options});
+	}
+	static void EndDuel(long pduel)
+	{
+		Call(CoreFunction::EndDuel, {pduel});
+	}
+	static void SetPlayerInfo(long pduel, int playerID, int lp, int startCount, int drawCount)
+	{
+		Call(CoreFunction::SetPlayerInfo, {pduel, playerID, lp, startCount, drawCount});
+	}
+	static void GetLogMessage(long pduel, unsigned char* buf)
+	{
+		Call(CoreFunction::GetLogMessage, {pduel}, nullptr, 0, buf, LOG_MESSAGE_SIZE);
+	}
+	static int GetMessage(long pduel, unsigned char* buf)
+	{
+		return (int)Call(CoreFunction::GetMessage, {pduel}, nullptr, 0, buf, MESSAGE_SIZE);
+	}
+	static int Process(long pduel)
+	{
+		return (int)Call(CoreFunction::Process, {pduel});
+	}
+	static void NewCard(long pduel, unsigned int code, unsigned char owner, unsigned char playerID,
+	                    unsigned char location, unsigned char sequence, unsigned char position)
+	{
+		Call(CoreFunction::NewCard, {pduel, code, owner, playerID, location, sequence, position});
+	}
+	static void NewTagCard(long pduel, unsigned int code, unsigned char owner, unsigned char location)
+	{
+		Call(CoreFunction::NewTagCard, {pduel, code, owner, location});
+	}
+	static void NewRelayCard(long pduel, unsigned int code, unsigned char owner, unsigned char location, unsigned char playerNumber)
+	{
+		Call(CoreFunction::NewRelayCard, {pduel, code, owner, location, playerNumber});
+	}
+	static int QueryCard(long pduel, unsigned char playerID, unsigned char location, unsigned char sequence,
+	                     int queryFlag, unsigned char* buf, int useCache)
+	{
+		return (int)Call(CoreFunction::QueryCard, {pduel, playerID, location, sequence, queryFlag, useCache}, nullptr, 0, buf, MESSAGE_SIZE);
+	}
+	static int QueryFieldCount(long pduel, unsigned char playerID, unsigned char location)
+	{
+		return (int)Call(CoreFunction::QueryFieldCount, {pduel, playerID, location});
+	}
+	static int QueryFieldCard(long pduel, unsigned char playerID, unsigned char location, int queryFlag,
+	                          unsigned char* buf, int useCache)
+	{
+		return (int)Call(CoreFunction::QueryFieldCard, {pduel, playerID, location, queryFlag, useCache}, nullptr, 0, buf, MESSAGE_SIZE);
+	}
+	static int QueryFieldInfo(long pduel, unsigned char* buf)
+	{
+		return (int)Call(CoreFunction::QueryFieldInfo, {pduel}, nullptr, 0, buf, MESSAGE_SIZE);
+	}
+	static void SetResponsei(long pduel, int value)
+	{
+		Call(CoreFunction::SetResponsei, {pduel, value});
+	}
+	static void SetResponseb(long pduel, unsigned char* buf)
+	{
+		Call(CoreFunction::SetResponseb, {pduel}, buf, RESPONSE_SIZE);
+	}
+	static int PreloadScript(long pduel, char* script, int len)
+	{
+		// A length of zero means script is the name of a file
+		const std::size_t size = (len > 0) ? (std::size_t)len : std::strlen(script) + 1;
+		if(size > CHANNEL_DATA_SIZE)
+		{
+			Logger::Error(LogCategory::Core, "Script of %u bytes is too big for a sandboxed core", (unsigned int)size);
+			return 0;
+		}
+		return (int)Call(CoreFunction::PreloadScript, {pduel, len}, script, size);
+	}
+};
+
+template<int Slot>
+static void InstallStubs(CoreInterface& ci)
+{
+	typedef RemoteStubs<Slot> S;
+	ci.set_script_reader = &S::SetScriptReader;
+	ci.set_card_reader = &S::SetCardReader;
+	ci.set_message_handler = &S::SetMessageHandler;
+	ci.create_duel = &S::CreateDuel;
+	ci.start_duel = &S::StartDuel;
+	ci.end_duel = &S::EndDuel;
+	ci.set_player_info = &S::SetPlayerInfo;
+	ci.get_log_message = &S::GetLogMessage;
+	ci.get_message = &S::GetMessage;
+	ci.process = &S::Process;
+	ci.new_card = &S::NewCard;
+	ci.new_tag_card = &S::NewTagCard;
+	ci.new_relay_card = &S::NewRelayCard;
+	ci.query_card = &S::QueryCard;
+	ci.query_field_count = &S::QueryFieldCount;
+	ci.query_field_card = &S::QueryFieldCard;
+	ci.query_field_info = &S::QueryFieldInfo;
+	ci.set_responsei = &S::SetResponsei;
+	ci.set_responseb = &S::SetResponseb;
+	ci.preload_script = &S::PreloadScript;
+}
+
+static void InstallStubs(CoreInterface& ci, int slot)
+{
+	switch(slot)
+	{
+		case 0: InstallStubs<0>(ci); break;
+		case 1: InstallStubs<1>(ci); break;
+		case 2: InstallStubs<2>(ci); break;
+		case 3: InstallStubs<3>(ci); break;
+		case 4: InstallStubs<4>(ci); break;
+		case 5: InstallStubs<5>(ci); break;
+		case 6: InstallStubs<6>(ci); break;
+		case 7: InstallStubs<7>(ci); break;
+		case 8: InstallStubs<8>(ci); break;
+		case 9: InstallStubs<9>(ci); break;
+		case 10: InstallStubs<10>(ci); break;
+		case 11: InstallStubs<11>(ci); break;
+		case 12: InstallStubs<12>(ci); break;
+		case 13: InstallStubs<13>(ci); break;
+		case 14: InstallStubs<14>(ci); break;
+		case 15: InstallStubs<15>(ci); break;
+	}
+}
+
+#ifdef _WIN32
+
+static unsigned long long CurrentProcessId()
+{
+	return GetCurrentProcessId();
+}
+
+static std::string SharedMemoryName(unsigned int index)
+{
+	return "Local\\ygopen-sandbox-" + std::to_string(CurrentProcessId()) + "-" + std::to_string(index);
+}
+
+static std::string QuoteArgument(const std::string& arg)
+{
+	std::string quoted = "\"";
+	for(char c : arg)
+	{
+		if(c == '"')
+			quoted += '\\';
+		quoted += c;
+	}
+	return quoted + "\"";
+}
+
+#else
+
+static unsigned long long CurrentProcessId()
+{
+	return (unsigned long long)getpid();
+}
+
+static std::string SharedMemoryName(unsigned int index)
+{
+	return "/ygopen-sandbox-" + std::to_string(CurrentProcessId()) + "-" + std::to_string(index);
+}
+
+#endif
+
+CoreSandbox::CoreSandbox() :
+	shared(nullptr),
+	slot(-1),
+	alive(false),
+#ifdef _WIN32
+	process(nullptr)
+#else
+	pid(-1)
+#endif
+{}
+
+CoreSandbox::~CoreSandbox()
+{
+	Stop();
+}
+
+bool CoreSandbox::Start(const std::string& workerPath, const std::vector<std::string>& args, unsigned int timeoutMs)
+{
+	Stop();
+
+	static std::atomic<unsigned int> sandboxCount(0);
+	const std::string name = SharedMemoryName(sandboxCount++);
+	if(!memory.Create(name, sizeof(SandboxMemory)))
+		return false;
+
+	shared = new(memory.Data()) SandboxMemory();
+	std::memcpy(shared->header.magic, SANDBOX_MAGIC, sizeof(SANDBOX_MAGIC));
+	shared->header.version = SANDBOX_VERSION;
+	shared->header.channelCount = (uint32_t)CHANNEL_COUNT;
+	shared->header.hostPid = CurrentProcessId();
+
+	slot = AcquireStubSlot();
+	if(slot < 0)
+	{
+		Logger::Error(LogCategory::Core, "Too many core sandboxes, %s is not started", workerPath);
+		Stop();
+		return false;
+	}
+	sandboxes[slot] = this;
+
+#ifdef _WIN32
+	std::string commandLine = QuoteArgument(workerPath) + " " + QuoteArgument(name);
+	for(auto& arg : args)
+		commandLine += " " + QuoteArgument(arg);
+
+	STARTUPINFOA startup;
+	PROCESS_INFORMATION info;
+	std::memset(&startup, 0, sizeof(startup));
+	startup.cb = sizeof(startup);
+	if(!CreateProcessA(workerPath.c_str(), &commandLine[0], nullptr, nullptr, FALSE, 0, nullptr, nullptr, &startup, &info))
+	{
+		Logger::Error(LogCategory::Core, "Failed starting core worker %s", workerPath);
+		Stop();
+		return false;
+	}
+	CloseHandle(info.hThread);
+	process = (void*)info.hProcess;
+#else
+	std::vector<char*> argv;
+	argv.push_back(const_cast<char*>(workerPath.c_str()));
+	argv.push_back(const_cast<char*>(name.c_str()));
+	for(auto& arg : args)
+		argv.push_back(const_cast<char*>(arg.c_str()));
+	argv.push_back(nullptr);
+
+	pid_t child;
+	const int error = posix_spawn(&child, workerPath.c_str(), nullptr, nullptr, argv.data(), environ);
+	if(error != 0)
+	{
+		Logger::Error(LogCategory::Core, "Failed starting core worker %s: %s", workerPath, std::strerror(error));
+		Stop();
+		return false;
+	}
+	pid = child;
+#endif
+	alive = true;
+
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+	while(shared->header.workerState.load(std::memory_order_acquire) != WORKER_READY)
+	{
+		if(!CheckWorker())
+		{
+			Logger::Error(LogCategory::Core, "Core worker %s exited while starting", workerPath);
+			Stop();
+			return false;
+		}
+		if(std::chrono::steady_clock::now() > deadline)
+		{
+			Logger::Error(LogCategory::Core, "Core worker %s did not start in %u ms", workerPath, timeoutMs);
+			Stop();
+			return false;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	Logger::Info(LogCategory::Core, "Started core worker %s (%s)", workerPath, shared->header.coreVersion);
+	return true;
+}
+
+bool CoreSandbox::Stop()
+{
+	std::lock_guard<std::mutex> lock(processMutex);
+	const bool wasAlive = alive.exchange(false);
+	if(shared != nullptr)
+	{
+		shared->header.stop.store(1);
+		WakeWorker(shared->header);
+	}
+
+	// Given a moment to exit on its own, then killed
+	bool exited = true;
+#ifdef _WIN32
+	if(process != nullptr)
+	{
+		exited = (WaitForSingleObject((HANDLE)process, 1000) == WAIT_OBJECT_0);
+		if(!exited)
+		{
+			TerminateProcess((HANDLE)process, 1);
+			WaitForSingleObject((HANDLE)process, INFINITE);
+		}
+		CloseHandle((HANDLE)process);
+	}
+	process = nullptr;
+#else
+	if(pid > 0)
+	{
+		int status;
+		pid_t waited = 0;
+		for(int i = 0; i < 1000 && waited == 0; ++i)
+		{
+			waited = waitpid((pid_t)pid, &status, WNOHANG);
+			if(waited == 0)
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		exited = (waited != 0);
+		if(!exited)
+		{
+			kill((pid_t)pid, SIGKILL);
+			waitpid((pid_t)pid, &status, 0);
+		}
+	}
+	pid = -1;
+#endif
+	if(!exited)
+		Logger::Warning(LogCategory::Core, "Core worker did not stop, it was killed");
+
+	if(slot >= 0)
+	{
+		sandboxes[slot] = nullptr;
+		ReleaseStubSlot(slot);
+	}
+	slot = -1;
+	shared = nullptr;
+	memory.Close();
+	return wasAlive && exited;
+}
+
+bool CoreSandbox::CheckWorker()
+{
+	std::lock_guard<std::mutex> lock(processMutex);
+	if(!alive.load())
+		return false;
+#ifdef _WIN32
+	if(WaitForSingleObject((HANDLE)process, 0) == WAIT_OBJECT_0)
+	{
+		DWORD code = 0;
+		GetExitCodeProcess((HANDLE)process, &code);
+		Logger::Error(LogCategory::Core, "Core worker exited with code %u", (unsigned int)code);
+		alive = false;
+	}
+#else
+	int status;
+	const pid_t waited = waitpid((pid_t)pid, &status, WNOHANG);
+	if(waited == 0)
+		return true;
+	if(waited < 0)
+		Logger::Error(LogCategory::Core, "Core worker is gone: %s", std::strerror(errno));
+	else if(WIFSIGNALED(status))
+		Logger::Error(LogCategory::Core, "Core worker was killed by signal %d", WTERMSIG(status));
+	else
+		Logger::Error(LogCategory::Core, "Core worker exited with code %d", WEXITSTATUS(status));
+	pid = -1; // Reaped, Stop must not wait for it
+	alive = false;
+#endif
+	return alive.load();
+}
+
+void CoreSandbox::Fault(const char* reason)
+{
+	std::lock_guard<std::mutex> lock(processMutex);
+	if(!alive.exchange(false))
+		return;
+	Logger::Error(LogCategory::Core, "Core worker fault, killing it: %s", reason);
+#ifdef _WIN32
+	if(process != nullptr)
+		TerminateProcess((HANDLE)process, 1);
+#else
+	if(pid > 0)
+		kill((pid_t)pid, SIGKILL);
+#endif
+}
+
+bool CoreSandbox::IsAlive()
+{
+	return alive.load(std::memory_order_relaxed) && CheckWorker();
+}
+
+bool CoreSandbox::HasFailed() const
+{
+	return !alive.load(std::memory_order_relaxed);
+}
+
+unsigned int CoreSandbox::GetCapabilities() const
+{
+	return (shared != nullptr) ? shared->header.capabilities : 0;
+}
+
+std::string CoreSandbox::GetVersion() const
+{
+	return (shared != nullptr) ? shared->header.coreVersion : "";
+}
+
+void CoreSandbox::Bind(CoreInterface& core)
+{
+	InstallStubs(core, slot);
+}
+
+SandboxChannel& CoreSandbox::AcquireChannel()
+{
+	// Threads start looking at different channels so they rarely collide
+	static std::atomic<unsigned int> threadCount(0);
+	static thread_local unsigned int first = threadCount++;
+
+	for(unsigned int attempt = 0;; ++attempt)
+	{
+		for(std::size_t i = 0; i < CHANNEL_COUNT; ++i)
+		{
+			SandboxChannel& channel = shared->channels[(first + i) % CHANNEL_COUNT];
+			uint32_t expected = CHANNEL_FREE;
+			if(channel.state.load(std::memory_order_relaxed) == CHANNEL_FREE &&
+			   channel.state.compare_exchange_strong(expected, CHANNEL_BUSY, std::memory_order_acquire))
+				return channel;
+		}
+		std::this_thread::yield();
+	}
+}
+
+long long CoreSandbox::Call(CoreFunction function, const long long* args, std::size_t argCount,
+                            const void* in, std::size_t inSize, void* out, std::size_t outSize)
+{
+	if(!alive.load(std::memory_order_relaxed))
+		return 0;
+
+	SandboxChannel& channel = AcquireChannel();
+	channel.function = (uint32_t)function;
+	for(std::size_t i = 0; i < argCount && i < CHANNEL_ARGS; ++i)
+		channel.args[i] = args[i];
+	channel.size = (uint32_t)inSize;
+	if(inSize > 0)
+		std::memcpy(channel.data, in, inSize);
+	channel.state.store(CHANNEL_REQUEST);
+	WakeWorker(shared->header);
+
+	const unsigned int spinCount = SpinCount();
+	for(unsigned int spins = 0; channel.state.load(std::memory_order_acquire) != CHANNEL_RESPONSE; ++spins)
+	{
+		if(spins < spinCount)
+		{
+			CpuRelax();
+			continue;
+		}
+		std::this_thread::yield();
+		// The channel is abandoned, nobody answers anymore
+		if(spins % CHECK_INTERVAL == 0 && !CheckWorker())
+			return 0;
+	}
+
+	const long long result = channel.result;
+	const std::size_t size = channel.size;
+	if(out != nullptr && size > std::min(outSize, CHANNEL_DATA_SIZE))
+	{
+		channel.state.store(CHANNEL_FREE, std::memory_order_release);
+		Fault("reply does not fit the caller's buffer");
+		return 0;
+	}
+	if(out != nullptr && size > 0)
+		std::memcpy(out, channel.data, size);
+	channel.state.store(CHANNEL_FREE, std::memory_order_release);
+	return result;
+}
+
+// Worker side
+
+static void ServeCall(CoreInterface& core, SandboxChannel& channel)
+{
+	const int64_t* a = channel.args;
+	long long result = 0;
+	std::size_t size = 0;
+	switch((CoreFunction)channel.function)
+	{
+		case CoreFunction::CreateDuel:
+			result = core.create_duel((unsigned int)a[0]);
+			break;
+		case CoreFunction::StartDuel:
+			core.start_duel((long)a[0], (int)a[1]);
+			break;
+		case CoreFunction::EndDuel:
+			core.end_duel((long)a[0]);
+			break;
+		case CoreFunction::SetPlayerInfo:
+			core.set_player_info((long)a[0], (int)a[1], (int)a[2], (int)a[3], (int)a[4]);
+			break;
+		case CoreFunction::GetLogMessage:
+			channel.data[0] = '\0';
+			core.get_log_message((long)a[0], channel.data);
+			size = std::strlen((const char*)channel.data) + 1;
+			break;
+		case CoreFunction::GetMessage:
+			result = core.get_message((long)a[0], channel.data);
+			size = (result > 0) ? (std::size_t)result : 0;
+			break;
+		case CoreFunction::Process:
+			result = core.process((long)a[0]);
+			break;
+		case CoreFunction::NewCard:
+			core.new_card((long)a[0], (unsigned int)a[1], (unsigned char)a[2], (unsigned char)a[3],
+			              (unsigned char)a[4], (unsigned char)a[5], (unsigned char)a[6]);
+			break;
+		case CoreFunction::NewTagCard:
+			core.new_tag_card((long)a[0], (unsigned int)a[1], (unsigned char)a[2], (unsigned char)a[3]);
+			break;
+		case CoreFunction::NewRelayCard:
+			core.new_relay_card((long)a[0], (unsigned int)a[1], (unsigned char)a[2], (unsigned char)a[3], (unsigned char)a[4]);
+			break;
+		case CoreFunction::QueryCard:
+			result = core.query_card((long)a[0], (unsigned char)a[1], (unsigned char)a[2], (unsigned char)a[3],
+			                         (int)a[4], channel.data, (int)a[5]);
+			size = (result > 0) ? (std::size_t)result : 0;
+			break;
+		case CoreFunction::QueryFieldCount:
+			result = core.query_field_count((long)a[0], (unsigned char)a[1], (unsigned char)a[2]);
+			break;
+		case CoreFunction::QueryFieldCard:
+			result = core.query_field_card((long)a[0], (unsigned char)a[1], (unsigned char)a[2], (int)a[3],
+			                               channel.data, (int)a[4]);
+			size = (result > 0) ? (std::size_t)result : 0;
+			break;
+		case CoreFunction::QueryFieldInfo:
+			result = core.query_field_info((long)a[0], channel.data);
+			size = (result > 0) ? (std::size_t)result : 0;
+			break;
+		case CoreFunction::SetResponsei:
+			core.set_responsei((long)a[0], (int)a[1]);
+			break;
+		case CoreFunction::SetResponseb:
+			core.set_responseb((long)a[0], channel.data);
+			break;
+		case CoreFunction::PreloadScript:
+			result = core.preload_script((long)a[0], (char*)channel.data, (int)a[1]);
+			break;
+		default:
+			Logger::Warning(LogCategory::Core, "Sandboxed core got an unknown call (%u)", channel.function);
+			break;
+	}
+	channel.result = result;
+	channel.size = (uint32_t)std::min(size, CHANNEL_DATA_SIZE);
+}
+
+#ifdef _WIN32
+
+class HostWatch
+{
+	HANDLE host;
+public:
+	explicit HostWatch(unsigned long long pid) :
+		host(OpenProcess(SYNCHRONIZE, FALSE, (DWORD)pid))
+	{}
+	~HostWatch()
+	{
+		if(host != nullptr)
+			CloseHandle(host);
+	}
+	bool HostAlive() const
+	{
+		return host == nullptr || WaitForSingleObject(host, 0) != WAIT_OBJECT_0;
+	}
+};
+
+#else
+
+class HostWatch
+{
+	pid_t host;
+public:
+	explicit HostWatch(unsigned long long pid) :
+		host((pid_t)pid)
+	{}
+	// Orphans are adopted by another process
+	bool HostAlive() const
+	{
+		return getppid() == host;
+	}
+};
+
+#endif
+
+int CoreSandbox::Serve(const char* name, CoreInterface& core)
+{
+	SharedMemory memory;
+	if(!memory.Open(name, sizeof(SandboxMemory)))
+		return 1;
+	SandboxMemory* shared = (SandboxMemory*)memory.Data();
+	SandboxHeader& header = shared->header;
+	if(std::memcmp(header.magic, SANDBOX_MAGIC, sizeof(SANDBOX_MAGIC)) != 0 ||
+	   header.version != SANDBOX_VERSION || header.channelCount != CHANNEL_COUNT)
+	{
+		Logger::Error(LogCategory::Core, "%s is not a compatible core sandbox", name);
+		return 1;
+	}
+
+	header.capabilities = core.GetCapabilities();
+	std::strncpy(header.coreVersion, core.GetVersion().c_str(), VERSION_SIZE - 1);
+	header.workerState.store(WORKER_READY, std::memory_order_release);
+
+	const HostWatch watch(header.hostPid);
+	const unsigned int spinCount = SpinCount();
+	unsigned int idle = 0;
+	std::chrono::microseconds sleep = WORKER_SLEEP;
+	auto requested = [shared]() -> bool
+	{
+		for(auto& channel : shared->channels)
+		{
+			if(channel.state.load() == CHANNEL_REQUEST)
+				return true;
+		}
+		return false;
+	};
+	while(header.stop.load(std::memory_order_acquire) == 0)
+	{
+		bool served = false;
+		for(auto& channel : shared->channels)
+		{
+			if(channel.state.load(std::memory_order_acquire) != CHANNEL_REQUEST)
+				continue;
+			ServeCall(core, channel);
+			channel.state.store(CHANNEL_RESPONSE, std::memory_order_release);
+			served = true;
+		}
+		if(served)
+		{
+			idle = 0;
+			sleep = WORKER_SLEEP;
+			continue;
+		}
+
+		++idle;
+		if(idle < spinCount)
+			CpuRelax();
+		else if(idle < spinCount + YIELD_COUNT)
+			std::this_thread::yield();
+		else
+		{
+			// Announced before looking at the channels one last time: a
+			// request posted after that look sees it and wakes the worker
+			const uint32_t seen = header.wakeups.load();
+			header.workerSleeping.store(1);
+			if(!requested() && header.stop.load() == 0)
+				WaitForWakeup(header, seen, sleep);
+			header.workerSleeping.store(0, std::memory_order_relaxed);
+			sleep = std::min(sleep * 2, WORKER_SLEEP_MAX);
+			if(!watch.HostAlive())
+			{
+				Logger::Warning(LogCategory::Core, "Core sandbox host exited, stopping");
+				SharedMemory::Remove(name);
+				break;
+			}
+		}
+	}
+
+	header.workerState.store(WORKER_STOPPED, std::memory_order_release);
+	return 0;
+}
+
+} // namespace YGOpen
@@ -0,0 +1,87 @@
+#ifndef __CORE_SANDBOX__
+#define __CORE_SANDBOX__
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "util/shared_memory.hpp"
+
+namespace YGOpen
+{
+
+class CoreInterface;
+enum class CoreFunction;
+struct SandboxMemory;
+struct SandboxChannel;
+
+// Runs a core in a worker process (see tools/core_worker.cpp), so a
+// crash in the core or its scripts only ends that worker and the duels
+// running on it. A CoreInterface loaded from a sandbox has the same
+// functions as one loaded in process; its calls go through channels in
+// memory shared with the worker, without any system call while both
+// sides are busy.
+//
+// The worker reads cards and scripts with its own DatabaseManager and
+// ScriptProvider, set up from its command line. It serves one call at a
+// time, run several sandboxes to use more than one processor.
+class CoreSandbox
+{
+	SharedMemory memory;
+	SandboxMemory* shared;
+	int slot; // Of the stubs CoreInterface functions are replaced with
+	std::atomic<bool> alive;
+	std::mutex processMutex; // Serializes checking on the worker
+#ifdef _WIN32
+	void* process;
+#else
+	long pid;
+#endif
+
+	friend class CoreInterface;
+	// Points every function of core to this sandbox's stubs
+	void Bind(CoreInterface& core);
+
+	bool CheckWorker();
+	// The worker broke the protocol and cannot be trusted anymore, it is
+	// killed and calls return zero from then on
+	void Fault(const char* reason);
+	SandboxChannel& AcquireChannel();
+
+	CoreSandbox(const CoreSandbox&) = delete;
+	CoreSandbox& operator=(const CoreSandbox&) = delete;
+public:
+	CoreSandbox();
+	~CoreSandbox();
+
+	// Spawns workerPath with the given arguments (after the name of the
+	// shared memory) and waits for it to load its core
+	bool Start(const std::string& workerPath, const std::vector<std::string>& args, unsigned int timeoutMs = 10000);
+	// Asks the worker to exit, killing it if it does not. Every
+	// CoreInterface loaded from the sandbox must be unloaded before
+	bool Stop();
+	// False once the worker exited or was killed, calls then return zero
+	bool IsAlive();
+	// True once a call or IsAlive found the worker gone. Unlike IsAlive
+	// it does not check on the worker, so it costs nothing per call.
+	bool HasFailed() const;
+
+	unsigned int GetCapabilities() const;
+	std::string GetVersion() const;
+
+	// Forwards one call to the worker. in is copied to the worker before
+	// the call, whatever the call wrote to its buffer is copied to out.
+	// A reply bigger than outSize is a fault of the worker (see Fault).
+	long long Call(CoreFunction function, const long long* args, std::size_t argCount,
+	               const void* in = nullptr, std::size_t inSize = 0,
+	               void* out = nullptr, std::size_t outSize = 0);
+
+	// Worker side, serves calls on core until the host stops the sandbox
+	// or exits. Returns the worker's exit code.
+	static int Serve(const char* name, CoreInterface& core);
+};
+
+} // namespace YGOpen
+
+#endif // __CORE_SANDBOX__
@@ -1,149 +1,179 @@
 #include "database_manager.hpp"
-#include <sqlite3.h>
 #include <cstring>
 
-#include "enums/type.hpp"
 #include "card.hpp"
 
 namespace YGOpen
 {
 
-//static const char * errorString  = "???";
-static const char* sqlSelect = "select * from datas,texts where datas.id=texts.id";
-
-int DatabaseManager::CoreCardReader(unsigned int code, CardData* cd)
+// Direct-mapped copies of the cards a thread read last, already in the
+// layout the core expects, so a hit is two compares and one aligned copy.
+// Each is tagged with the id of the pool it came from, which is never
+// reused, so threads serving duels on different pools share the cache.
+struct CoreCardCache
 {
-	const CardData* wantedCard = GetCardDataByCode(code);
-	if(wantedCard == nullptr)
-		std::memset((void*)cd, 0, sizeof(CardData));
-	else
-		std::memcpy((void*)cd, (void*)wantedCard, sizeof(CardData));
-	return 0;
-}
-
-void DatabaseManager::ReadCardData(sqlite3_stmt* stmt, CardData* cd, CardDataExtra* cde)
-{
-	// Card Data
-	cd->code = sqlite3_column_int(stmt, 0);
-	// ot is 1, it is added to the extra card struct
-	cd->alias = sqlite3_column_int(stmt, 2);
-	cd->setcode = sqlite3_column_int64(stmt, 3);
-	cd->type = sqlite3_column_int(stmt, 4);
-	cd->attack = sqlite3_column_int(stmt, 5);
-	cd->defense = sqlite3_column_int(stmt, 6);
-	if(cd->type & TypeLink)
-	{
-		cd->link_marker = cd->defense;
-		cd->defense = 0;
-	}
-	else cd->link_marker = 0;
-	unsigned int level = sqlite3_column_int(stmt, 7);
-	if((level & 0x80000000) != 0) // Negative levels are handled too
+	static const std::size_t SIZE = 256;
+	unsigned long long poolIds[SIZE];
+	unsigned int codes[SIZE]; // 0 means the entry is empty
+	CardData cards[SIZE];
+
+	// The pool id is mixed in so pools do not evict each other's copies
+	// of the same card
+	static std::size_t Index(unsigned long long poolId, unsigned int code)
 	{
-		level = -level;
-		cd->level = -(level & 0xFF);
+		const unsigned int mix = (unsigned int)((poolId * 0x9E3779B97F4A7C15ull) >> 32);
+		return (code ^ mix) & (SIZE - 1);
 	}
-	else cd->level = level & 0xFF;
-	cd->lscale = (level >> 24) & 0xFF;
-	cd->rscale = (level >> 16) & 0xFF;
-	cd->race = sqlite3_column_int(stmt, 8);
-	cd->attribute = sqlite3_column_int(stmt, 9);
+};
+
+static thread_local CoreCardCache coreCardCache;
+
+DatabaseManager::DatabaseManager(TextLoading textLoading, std::size_t textCacheSize) :
+	textLoading(textLoading),
+	textCacheSize(textCacheSize),
+	pool(std::make_shared<CardPool>(textLoading, textCacheSize)),
+	activePool(pool.get())
+{}
 
-	// Card Data Extra
-	cde->code = sqlite3_column_int(stmt, 0); 
-	cde->ot = sqlite3_column_int(stmt, 1);
-	cde->category = sqlite3_column_int(stmt, 10);
-}
 
-void DatabaseManager::ReadCardStrings(sqlite3_stmt* stmt, CardStrings* cs)
+// Must be called with writeMutex held
+void DatabaseManager::Publish(std::shared_ptr<const CardPool> next)
 {
-	// 11 is id again, skip it
-	cs->name = std::string((const char*)sqlite3_column_text(stmt, 12));
-	cs->desc = std::string((const char*)sqlite3_column_text(stmt, 13));
-	
-	for(int i = 14; i < 30; ++i)
-		cs->str[i - 14] = std::string((const char*)sqlite3_column_text(stmt, i));
+	std::shared_ptr<const CardPool> old = pool;
+	std::atomic_store(&pool, next);
+	activePool.store(next.get(), std::memory_order_release);
+	retiredPools.push_back(std::move(old));
 }
 
 bool DatabaseManager::LoadDatabase(const char* fn)
 {
-	sqlite3* db;
-	sqlite3_stmt* stmt;
-	
-	if(sqlite3_open_v2(fn, &db, SQLITE_OPEN_READONLY, 0) != SQLITE_OK)
-	{
-		puts(sqlite3_errmsg(db));
+	std::lock_guard<std::mutex> lock(writeMutex);
+	std::shared_ptr<CardPool> next(pool->Clone());
+	if(!next)
 		return false;
-	}
+	if(!next->LoadDatabase(fn))
+		return false;
+	Publish(std::move(next));
+	return true;
+}
 
-	if(sqlite3_prepare_v2(db, sqlSelect, -1, &stmt, 0) != SQLITE_OK)
-	{
-		puts(sqlite3_errmsg(db));
-		sqlite3_close(db);
+bool DatabaseManager::LoadDatabases(const std::vector<std::string>& fns)
+{
+	std::lock_guard<std::mutex> lock(writeMutex);
+	std::shared_ptr<CardPool> next(pool->Clone());
+	if(!next)
 		return false;
-	}
+	const std::size_t loaded = next->LoadDatabases(fns);
+	if(loaded == 0)
+		return false;
+	Publish(std::move(next));
+	return loaded == fns.size();
+}
+
+bool DatabaseManager::LoadSnapshot(const char* fn)
+{
+	std::lock_guard<std::mutex> lock(writeMutex);
+	std::shared_ptr<CardPool> next = std::make_shared<CardPool>(textLoading, textCacheSize);
+	if(!next->LoadSnapshot(fn))
+		return false;
+	Publish(std::move(next));
+	return true;
+}
 
-	CardData cd;
-	CardDataExtra cde;
-	CardStrings cs;
+bool DatabaseManager::SaveSnapshot(const char* fn) const
+{
+	return AcquirePool()->SaveSnapshot(fn);
+}
 
-	for(int step = SQLITE_OK; step != SQLITE_DONE; step = sqlite3_step(stmt))
+bool DatabaseManager::Reload(const std::vector<std::string>& fns)
+{
+	// Built without holding the lock, readers and other loads are not blocked
+	std::shared_ptr<CardPool> next = std::make_shared<CardPool>(textLoading, textCacheSize);
+	const std::size_t loaded = next->LoadDatabases(fns);
+	if(loaded == 0)
+		return false;
+
+	std::lock_guard<std::mutex> lock(writeMutex);
+	Publish(std::move(next));
+	return loaded == fns.size();
+}
+
+std::shared_ptr<const CardPool> DatabaseManager::AcquirePool() const
+{
+	return std::atomic_load(&pool);
+}
+
+std::size_t DatabaseManager::ReclaimPools()
+{
+	std::lock_guard<std::mutex> lock(writeMutex);
+	auto it = retiredPools.begin();
+	while(it != retiredPools.end())
 	{
-		if(step == SQLITE_BUSY || step == SQLITE_ERROR || step == SQLITE_MISUSE)
-		{
-			puts(sqlite3_errmsg(db));
-			sqlite3_finalize(stmt);
-			sqlite3_close(db);
-			return false;
-		}
-		else if(step == SQLITE_ROW)
-		{
-			// Card Data
-			ReadCardData(stmt, &cd, &cde);
-			if(cardData.count(cd.code) > 0)
-				cardData.erase(cd.code);
-			cardData.insert(std::make_pair(cd.code, cd));
-			if(cardDataExtra.count(cde.code) > 0)
-				cardDataExtra.erase(cde.code);
-			cardDataExtra.insert(std::make_pair(cde.code, cde));
-
-			// Card Strings
-			ReadCardStrings(stmt, &cs);
-			if(cardStrings.count(cd.code) > 0)
-				cardStrings.erase(cd.code);
-			cardStrings.insert(std::make_pair(cd.code, cs));
-		}
+		if(it->use_count() == 1)
+			it = retiredPools.erase(it);
+		else
+			++it;
 	}
-	sqlite3_finalize(stmt);
-	sqlite3_close(db);
+	return retiredPools.size();
+}
 
-	std::printf("Number of cards loaded in total: %lu\n", cardData.size());
+const CardData* DatabaseManager::GetCardDataByCode(unsigned int code) const
+{
+	return activePool.load(std::memory_order_acquire)->GetCardDataByCode(code);
+}
 
-	return true;
+void DatabaseManager::ReadCoreCard(unsigned int code, CardData* cd) const
+{
+	ReadCoreCard(*activePool.load(std::memory_order_acquire), code, cd);
 }
 
-const CardData* DatabaseManager::GetCardDataByCode(unsigned int code) const
+void DatabaseManager::ReadCoreCard(const CardPool& pool, unsigned int code, CardData* cd)
+{
+	const CardPool* current = &pool;
+	CoreCardCache& cache = coreCardCache;
+	const unsigned long long poolId = current->GetId();
+	const std::size_t i = CoreCardCache::Index(poolId, code);
+	if(cache.codes[i] == code && cache.poolIds[i] == poolId && code != 0)
+	{
+		std::memcpy((void*)cd, (void*)&cache.cards[i], sizeof(CardData));
+		return;
+	}
+
+	const CardData* wantedCard = current->GetCardDataByCode(code);
+	if(wantedCard == nullptr)
+	{
+		std::memset((void*)cd, 0, sizeof(CardData));
+		return;
+	}
+	cache.poolIds[i] = poolId;
+	cache.codes[i] = code;
+	cache.cards[i] = *wantedCard;
+	std::memcpy((void*)cd, (void*)wantedCard, sizeof(CardData));
+}
+
+void DatabaseManager::GetCardDataBatch(const unsigned int* codes, std::size_t count, const CardData** out) const
 {
-	auto search = cardData.find(code);
-	if(search != cardData.end())
-		return &search->second;
-	return nullptr;
+	activePool.load(std::memory_order_acquire)->GetCardDataBatch(codes, count, out);
 }
 
 const CardDataExtra* DatabaseManager::GetCardDataExtraByCode(unsigned int code) const
 {
-	auto search = cardDataExtra.find(code);
-	if(search != cardDataExtra.end())
-		return &search->second;
-	return nullptr;
+	return activePool.load(std::memory_order_acquire)->GetCardDataExtraByCode(code);
+}
+
+CardText DatabaseManager::GetCardStringsByCode(unsigned int code) const
+{
+	return activePool.load(std::memory_order_acquire)->GetCardStringsByCode(code);
+}
+
+const CardFilterIndex& DatabaseManager::GetFilterIndex() const
+{
+	return activePool.load(std::memory_order_acquire)->GetFilterIndex();
 }
 
-const CardStrings* DatabaseManager::GetCardStringsByCode(unsigned int code) const
+std::size_t DatabaseManager::CountArchetype(const unsigned int* codes, std::size_t count, unsigned int setcode) const
 {
-	auto search = cardStrings.find(code);
-	if(search != cardStrings.end())
-		return &search->second;
-	return nullptr;
+	return activePool.load(std::memory_order_acquire)->CountArchetype(codes, count, setcode);
 }
 
 } // namespace YGOpen
@@ -1,31 +1,82 @@
 #ifndef __DATABASE_MANAGER__
 #define __DATABASE_MANAGER__
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <string>
-#include <unordered_map>
-#include <functional>
+#include <vector>
 #include "card.hpp"
-
-struct sqlite3_stmt;
+#include "card_pool.hpp"
 
 namespace YGOpen
 {
 
+// Owns the current CardPool. Every load builds a new pool off to the
+// side and atomically publishes it, so loads and reloads can run while
+// other threads keep reading cards; lookups only cost an atomic load.
+//
+// Pointers returned by the lookup functions below belong to the pool
+// that was current at the time. Replaced pools are kept alive until
+// ReclaimPools is called, so callers must only call it once no thread
+// is still using such pointers (e.g. between server ticks). Anything
+// that needs card data across reloads, such as a running duel, should
+// hold its own pool through AcquirePool instead.
 class DatabaseManager
 {
-	std::unordered_map<unsigned int, CardData> cardData;
-	std::unordered_map<unsigned int, CardDataExtra> cardDataExtra;
-	std::unordered_map<unsigned int, CardStrings> cardStrings;
+	TextLoading textLoading;
+	std::size_t textCacheSize;
+
+	std::mutex writeMutex; // Serializes loads and reclaiming
+	std::shared_ptr<const CardPool> pool;
+	std::atomic<const CardPool*> activePool;
+	std::vector<std::shared_ptr<const CardPool>> retiredPools;
 
-	int CoreCardReader(unsigned int code, CardData* cd);
+	void Publish(std::shared_ptr<const CardPool> next);
 
-	void ReadCardData(sqlite3_stmt* stmt, CardData* cd, CardDataExtra* cde);
-	void ReadCardStrings(sqlite3_stmt* stmt, CardStrings* cs) ;
+	DatabaseManager(const DatabaseManager&) = delete;
+	DatabaseManager& operator=(const DatabaseManager&) = delete;
 public:
+	// In lazy mode at most textCacheSize card texts are kept in memory
+	DatabaseManager(TextLoading textLoading = TextLoading::Eager, std::size_t textCacheSize = 1024);
+
+	// Add cards on top of the current ones, later databases override
+	// earlier ones. Each load copies every card loaded so far, so several
+	// databases are better loaded at once with LoadDatabases.
 	bool LoadDatabase(const char* filepath);
+	// Reads every database on its own thread, then merges them in the
+	// given order. Returns false if any of them failed to load, the
+	// others are still published. Nothing is published if none loaded.
+	bool LoadDatabases(const std::vector<std::string>& filepaths);
+
+	// Precompiled snapshots, see CardStore. Loading a snapshot replaces
+	// every card loaded so far; databases loaded afterwards still override it
+	bool LoadSnapshot(const char* filepath);
+	bool SaveSnapshot(const char* filepath) const;
+
+	// Replaces every card with the ones in the given databases, returns
+	// false if any of them failed. Nothing is published if none loaded.
+	bool Reload(const std::vector<std::string>& filepaths);
+
+	// The current pool, valid for as long as it is held
+	std::shared_ptr<const CardPool> AcquirePool() const;
+	// Frees replaced pools nobody holds anymore, returns how many are left
+	std::size_t ReclaimPools();
 
 	const CardData* GetCardDataByCode(unsigned int code) const;
+	// Fills cd the way the core's card reader expects, zeroed for unknown cards.
+	// Recently read cards are served from a small per-thread cache.
+	void ReadCoreCard(unsigned int code, CardData* cd) const;
+	// Same, from the given pool (i.e. the one a duel started with)
+	static void ReadCoreCard(const CardPool& pool, unsigned int code, CardData* cd);
+	// Resolves count codes at once, out[i] is nullptr for unknown cards
+	void GetCardDataBatch(const unsigned int* codes, std::size_t count, const CardData** out) const;
 	const CardDataExtra* GetCardDataExtraByCode(unsigned int code) const;
-	const CardStrings* GetCardStringsByCode(unsigned int code) const;
+	// Like the pointers above, the returned text belongs to the current
+	// pool, lazy loading evicting it from the cache does not invalidate it
+	CardText GetCardStringsByCode(unsigned int code) const;
+
+	const CardFilterIndex& GetFilterIndex() const;
+	std::size_t CountArchetype(const unsigned int* codes, std::size_t count, unsigned int setcode) const;
 };
 
 } // namespace YGOpen
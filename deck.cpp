@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <unordered_map>
 
 #include "deck.hpp"
@@ -7,36 +8,38 @@
 namespace YGOpen
 {
 
-Deck::Deck() : verified(false), usable(false)
-{}
-
-unsigned int Deck::Verify(DatabaseManager& dbm)
+// Looks every card up in batches, stores the first unknown one in missing
+static bool FindMissingCard(DatabaseManager& dbm, const std::vector<unsigned int>& cards, unsigned int* missing)
 {
-	for(auto& card : main)
+	const CardData* found[64];
+	for(std::size_t first = 0; first < cards.size(); first += 64)
 	{
-		if(dbm.GetCardDataByCode(card) == nullptr)
+		const std::size_t n = std::min<std::size_t>(cards.size() - first, 64);
+		dbm.GetCardDataBatch(cards.data() + first, n, found);
+		for(std::size_t i = 0; i < n; ++i)
 		{
-			verified = false;
-			return card;
+			if(found[i] == nullptr)
+			{
+				*missing = cards[first + i];
+				return true;
+			}
 		}
 	}
+	return false;
+}
 
-	for(auto& card : extra)
-	{
-		if(dbm.GetCardDataByCode(card) == nullptr)
-		{
-			verified = false;
-			return card;
-		}
-	}
+Deck::Deck() : verified(false), usable(false)
+{}
 
-	for(auto& card : side)
+unsigned int Deck::Verify(DatabaseManager& dbm)
+{
+	unsigned int missing;
+	if(FindMissingCard(dbm, main, &missing) ||
+	   FindMissingCard(dbm, extra, &missing) ||
+	   FindMissingCard(dbm, side, &missing))
 	{
-		if(dbm.GetCardDataByCode(card) == nullptr)
-		{
-			verified = false;
-			return card;
-		}
+		verified = false;
+		return missing;
 	}
 
 	verified = true;
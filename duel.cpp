@@ -1,12 +1,23 @@
+#include <algorithm>
 #include <cassert>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <map>
+#include <unordered_set>
 
 #include "duel.hpp"
 
+#include "core_auxiliary.hpp"
+#include "core_calls.hpp"
 #include "core_interface.hpp"
+#include "database_manager.hpp"
+#include "deck.hpp"
 
 #include "duel_observer.hpp"
+#include "script_provider.hpp"
+#include "util/logger.hpp"
 
 namespace YGOpen
 {
@@ -160,99 +171,240 @@ static const std::map<CoreMessage, unsigned int> msgLengths =
 	{CoreMessage::MatchKill      , 1}
 };
 
-Duel::Duel(CoreInterface& core, unsigned int seed) :
+Duel::Duel(CoreInterface& core, unsigned int seed, const CoreContext* context) :
 	core(core),
-	pduel(0)
+	context(context),
+	pool(CoreAuxiliary::AcquirePool(context)),
+	pduel(0),
+	stopMessage(nullptr, 0)
 {
-	pduel = core.create_duel(seed);
+	pduel = CoreCalls::CreateDuel(core, seed);
+	CoreAuxiliary::RegisterDuel(pduel, &core);
+}
+
+// The core the duel keeps loaded, which it cannot run without
+static CoreInterface& HeldCore(const std::shared_ptr<CoreInterface>& core)
+{
+	if(!core)
+	{
+		Logger::Error(LogCategory::Duel, "Duel created without a core, see Duel::Create");
+		Logger::Flush();
+		std::abort();
+	}
+	return *core;
+}
+
+Duel::Duel(std::shared_ptr<CoreInterface> core, unsigned int seed, const CoreContext* context) :
+	image(std::move(core)),
+	core(HeldCore(image)),
+	context(context),
+	pool(CoreAuxiliary::AcquirePool(context)),
+	pduel(0),
+	stopMessage(nullptr, 0)
+{
+	pduel = CoreCalls::CreateDuel(this->core, seed);
+	CoreAuxiliary::RegisterDuel(pduel, image.get());
+}
+
+std::unique_ptr<Duel> Duel::Create(std::shared_ptr<CoreInterface> core, unsigned int seed, const CoreContext* context)
+{
+	if(!core)
+	{
+		Logger::Error(LogCategory::Duel, "No core loaded to create a duel with");
+		return nullptr;
+	}
+	return std::unique_ptr<Duel>(new Duel(std::move(core), seed, context));
 }
 
 Duel::~Duel()
 {
-	core.end_duel(pduel);
+	if(preloading.valid())
+		preloading.wait();
+	CoreAuxiliary::UnregisterDuel(pduel, &core);
+	CoreCalls::EndDuel(core, pduel);
 }
 
 void Duel::SetPlayerInfo(int playerID, int startLP, int startHand, int drawCount)
 {
-	core.set_player_info(pduel, playerID, startLP, startHand, drawCount);
+	CoreCalls::SetPlayerInfo(core, pduel, playerID, startLP, startHand, drawCount);
 }
 
 void Duel::Start(int options)
 {
-	core.start_duel(pduel, options);
+	CoreAuxiliary::Binding binding(context, pool.get());
+	if(preloading.valid())
+		preloading.get();
+	CoreCalls::StartDuel(core, pduel, options);
 }
 
 void Duel::PreloadScript(const std::string& file)
 {
-	core.preload_script(pduel, (char*)file.c_str(), 0);
+	CoreAuxiliary::Binding binding(context, pool.get());
+	CoreCalls::PreloadScript(core, pduel, (char*)file.c_str(), 0);
+}
+
+std::vector<std::string> Duel::DeckScripts(const DatabaseManager& dbm, const Deck& deck0, const Deck& deck1)
+{
+	std::vector<unsigned int> pending;
+	for(const Deck* deck : {&deck0, &deck1})
+	{
+		pending.insert(pending.end(), deck->main.begin(), deck->main.end());
+		pending.insert(pending.end(), deck->extra.begin(), deck->extra.end());
+	}
+
+	// Aliases are looked up a round at a time until none is left
+	std::unordered_set<unsigned int> codes;
+	std::vector<const CardData*> found;
+	while(!pending.empty())
+	{
+		std::sort(pending.begin(), pending.end());
+		pending.erase(std::unique(pending.begin(), pending.end()), pending.end());
+		found.resize(pending.size());
+		dbm.GetCardDataBatch(pending.data(), pending.size(), found.data());
+
+		std::vector<unsigned int> aliases;
+		for(std::size_t i = 0; i < pending.size(); ++i)
+		{
+			if(found[i] == nullptr || !codes.insert(pending[i]).second)
+				continue;
+			if(found[i]->alias != 0 && codes.find(found[i]->alias) == codes.end())
+				aliases.push_back(found[i]->alias);
+		}
+		pending.swap(aliases);
+	}
+
+	std::vector<unsigned int> sorted(codes.begin(), codes.end());
+	std::sort(sorted.begin(), sorted.end());
+	std::vector<std::string> files;
+	files.reserve(sorted.size());
+	char file[32];
+	for(auto code : sorted)
+	{
+		std::snprintf(file, sizeof(file), "./script/c%u.lua", code);
+		files.push_back(file);
+	}
+	return files;
+}
+
+void Duel::PreloadScripts(std::vector<std::string> files, bool async)
+{
+	if(preloading.valid())
+		preloading.wait();
+
+	// Only the provider is warmed: the core loads each script itself when
+	// the card is created, and must not be called from another thread
+	ScriptProvider* sp = CoreAuxiliary::GetScriptProvider(context);
+	if(sp == nullptr)
+	{
+		Logger::Warning(LogCategory::Duel, "No ScriptProvider to preload scripts from");
+		return;
+	}
+	if(!async)
+	{
+		sp->Warm(files);
+		return;
+	}
+	preloading = std::async(std::launch::async, [sp](const std::vector<std::string>& files)
+	{
+		sp->Warm(files);
+	}, std::move(files));
 }
 
-void Duel::Process()
+DuelMessage Duel::Process()
 {
+	CoreAuxiliary::Binding binding(context, pool.get());
+	const bool messageLength = core.HasCapability(CoreCapability::MessageLength);
 	DuelMessage lastMessage = DuelMessage::Continue;
+	stopMessage = BasicBuffer(nullptr, 0);
 	while (true) 
 	{
-		const int bufferLength = core.process(pduel) & 0xFFFF;
+		int bufferLength = CoreCalls::Process(core, pduel) & 0xFFFF;
+		// A sandboxed core whose worker crashed answers nothing anymore.
+		// The call that found it gone already marked it, nothing to ask.
+		if(bufferLength == 0 && core.HasFailed())
+		{
+			Logger::Error(LogCategory::Duel, "Core of duel %ld is gone, stopping it", pduel);
+			return DuelMessage::EndOfDuel;
+		}
 
 		if (bufferLength > 0)
 		{
-			core.get_message(pduel, (unsigned char*)&buffer);
+			const int copied = CoreCalls::GetMessage(core, pduel, (unsigned char*)&buffer);
+			// The length get_message reports is exact where process' 16 bits
+			// would wrap, but it cannot be more than the buffer holds: a core
+			// reporting more overran it, only what fits is read
+			if(messageLength)
+				bufferLength = copied;
+			if(bufferLength > DUEL_BUFFER_SIZE)
+			{
+				Logger::Error(LogCategory::Duel, "Core of duel %ld wrote %d bytes of messages, more than the %d of the buffer",
+				              pduel, bufferLength, DUEL_BUFFER_SIZE);
+				bufferLength = DUEL_BUFFER_SIZE;
+			}
 			lastMessage = Analyze(bufferLength);
 		}
 
 		if(lastMessage != DuelMessage::Continue)
-			return;
+			return lastMessage;
 	}
 }
 
+std::pair<void*, size_t> Duel::LastMessage() const
+{
+	return stopMessage;
+}
+
 void Duel::NewCard(int code, int owner, int playerID, int location, int sequence, int position)
 {
-	core.new_card(pduel, code, owner, playerID, location, sequence, position);
+	CoreAuxiliary::Binding binding(context, pool.get());
+	CoreCalls::NewCard(core, pduel, code, owner, playerID, location, sequence, position);
 }
 
 void Duel::NewTagCard(int code, int owner, int location)
 {
-	core.new_tag_card(pduel, code, owner, location);
+	CoreAuxiliary::Binding binding(context, pool.get());
+	CoreCalls::NewTagCard(core, pduel, code, owner, location);
 }
 
 void Duel::NewRelayCard(int code, int owner, int location, int playerNumber)
 {
-	core.new_relay_card(pduel, code, owner, location, playerNumber);
+	CoreAuxiliary::Binding binding(context, pool.get());
+	CoreCalls::NewRelayCard(core, pduel, code, owner, location, playerNumber);
 }
 
 std::pair<void*, size_t> Duel::QueryCard(int playerID, int location, int sequence, int queryFlag, bool useCache)
 {
-	const size_t bufferLength = core.query_card(pduel, playerID, location, sequence, queryFlag, queryBuffer, useCache);
+	const size_t bufferLength = CoreCalls::QueryCard(core, pduel, playerID, location, sequence, queryFlag, queryBuffer, useCache);
 	return std::make_pair((void*)queryBuffer, bufferLength);
 }
 
 int Duel::QueryFieldCount(int playerID, int location)
 {
-	return core.query_field_count(pduel, playerID, location);
+	return CoreCalls::QueryFieldCount(core, pduel, playerID, location);
 }
 
 std::pair<void*, size_t> Duel::QueryFieldCard(int playerID, int location, int queryFlag, bool useCache)
 {
-	const size_t bufferLength = core.query_field_card(pduel, playerID, location, queryFlag, queryBuffer, useCache);
+	const size_t bufferLength = CoreCalls::QueryFieldCard(core, pduel, playerID, location, queryFlag, queryBuffer, useCache);
 	return std::make_pair((void*)queryBuffer, bufferLength);
 }
 
 std::pair<void*, size_t> Duel::QueryFieldInfo()
 {
-	const size_t bufferLength = core.query_field_info(pduel, queryBuffer);
+	const size_t bufferLength = CoreCalls::QueryFieldInfo(core, pduel, queryBuffer);
 	return std::make_pair((void*)queryBuffer, bufferLength);
 }
 
 void Duel::SetResponseInteger(int val)
 {
-	core.set_responsei(pduel, val);
+	CoreCalls::SetResponsei(core, pduel, val);
 }
 
-void Duel::SetResponseBuffer(void* buff, size_t length)
+void Duel::SetResponseBuffer(const void* buff, size_t length)
 {
 	void* b = std::calloc(1, 64);
-	std::memcpy(b, buff, length);
-	core.set_responseb(pduel, (unsigned char*)b);
+	std::memcpy(b, buff, std::min<size_t>(length, 64));
+	CoreCalls::SetResponseb(core, pduel, (unsigned char*)b);
 	std::free(b);
 }
 
@@ -270,7 +422,10 @@ DuelMessage Duel::Analyze(unsigned int bufferLen)
 		const DuelMessage msgResult = HandleCoreMessage(msgType, &bm);
 
 		if(msgResult != DuelMessage::Continue)
+		{
+			stopMessage = cb;
 			return msgResult;
+		}
 	}
 	return DuelMessage::Continue;
 }
@@ -287,7 +442,8 @@ DuelMessage Duel::HandleCoreMessage(CoreMessage msgType, BufferManipulator* bm)
 	}
 	else
 	{
-		puts("\tMessage not handled");
+		Logger::Error(LogCategory::Duel, "Message not handled: %d", msgType);
+		Logger::Flush();
 		std::abort();
 	}
 	
@@ -332,7 +488,8 @@ DuelMessage Duel::HandleCoreMessage(CoreMessage msgType, BufferManipulator* bm)
 			break;
 			
 			default:
-				puts("\tNon-fixed forwarding not handled");
+				Logger::Error(LogCategory::Duel, "Non-fixed forwarding not handled: %d", msgType);
+				Logger::Flush();
 				std::abort();
 			break;
 		}
@@ -1,5 +1,9 @@
 #ifndef __DUEL_HPP__
 #define __DUEL_HPP__
+#include <cstddef>
+#include <future>
+#include <memory>
+#include <string>
 #include <vector>
 #include <utility>
 
@@ -19,15 +23,24 @@ enum class DuelMessage : int
 	EndOfDuel = 2,
 };
 
+class CardPool;
 class CoreInterface;
+struct CoreContext;
+class DatabaseManager;
+class Deck;
 class DuelObserver;
 
 class Duel
 {
+	std::shared_ptr<CoreInterface> image; // Keeps the core loaded, if given
 	CoreInterface& core;
+	const CoreContext* context;
+	std::shared_ptr<const CardPool> pool; // Cards are read from it, reloads do not affect the duel
 	unsigned char buffer[DUEL_BUFFER_SIZE];
 	unsigned char queryBuffer[DUEL_BUFFER_SIZE];
 	long pduel;
+	BasicBuffer stopMessage; // What Process stopped on
+	std::future<void> preloading;
 
 	std::vector<DuelObserver*> observers;
 
@@ -36,18 +49,42 @@ class Duel
 
 	void Message(void* buff, size_t length);
 public:
-	Duel(CoreInterface& core, unsigned int seed);
+	// The core callbacks serve the duel from context if given, see
+	// CoreAuxiliary, otherwise from whatever the calling thread has bound
+	Duel(CoreInterface& core, unsigned int seed, const CoreContext* context = nullptr);
+	// Keeps core loaded until the duel ends, see CoreManager. core must
+	// not be null, which aborts.
+	Duel(std::shared_ptr<CoreInterface> core, unsigned int seed, const CoreContext* context = nullptr);
 	~Duel();
 
+	// Same as the constructor above, but returns nullptr if no core is
+	// given, e.g. when CoreManager::AcquireCore had none loaded
+	static std::unique_ptr<Duel> Create(std::shared_ptr<CoreInterface> core, unsigned int seed,
+	                                    const CoreContext* context = nullptr);
+
 	void AddObserver(DuelObserver* duelObs);
 
 	void Start(int options);
 
 	void PreloadScript(const std::string& file);
 
+	// Scripts every card in both decks can load, following aliases,
+	// in the form the core asks the script reader for them
+	static std::vector<std::string> DeckScripts(const DatabaseManager& dbm, const Deck& deck0, const Deck& deck1);
+	// Reads all the given scripts into the ScriptProvider serving the
+	// duel before it starts, so they are not read from disk in the middle
+	// of a turn. If async, they are read on another thread and Start
+	// waits for it. The core still loads each one when it needs it.
+	void PreloadScripts(std::vector<std::string> files, bool async = false);
+
 	void SetPlayerInfo(int playerID, int startLP, int startHand, int drawCount);
 
-	void Process();
+	// Runs the duel until it needs a response or ends, which it returns.
+	// Duels whose core is gone end.
+	DuelMessage Process();
+	// Message the last Process stopped on, i.e. the one asking for a
+	// response. Valid until Process is called again.
+	std::pair<void*, size_t> LastMessage() const;
 
 	void NewCard(int code, int owner, int playerID, int location, int sequence, int position);
 	void NewTagCard(int code, int owner, int location);
@@ -60,7 +97,8 @@ public:
 	std::pair<void*, size_t> QueryFieldInfo();
 	
 	void SetResponseInteger(int val);
-	void SetResponseBuffer(void* buff, size_t length);
+	// The core takes up to 64 bytes, the rest is cut
+	void SetResponseBuffer(const void* buff, size_t length);
 
 	//void SetDeck(int player, std::vector<unsigned int>& deck);
 	//void SetExtraDeck(int player, std::vector<unsigned int>& deck);
@@ -0,0 +1,292 @@
+#include "duel_scheduler.hpp"
+
+#include <cstring>
+#include <deque>
+#include <thread>
+
+#include "util/logger.hpp"
+
+namespace YGOpen
+{
+
+// Task states. Responses are only taken once the duel asked for one,
+// i.e. from its listener or while it waits, and responding threads
+// claim the task before writing the response, so only one of them does
+// and never while the worker reads it.
+static const int TASK_QUEUED = 0;
+static const int TASK_RUNNING = 1;
+static const int TASK_LISTENING = 2; // The listener is being called
+static const int TASK_WAITING = 3;
+static const int TASK_ENDED = 4;
+static const int TASK_RESPONDING = 5; // Was waiting
+static const int TASK_RESPONDING_LISTENING = 6; // Was listening
+static const int TASK_ANSWERED = 7; // Listening, and a response already came
+
+static const std::size_t RESPONSE_SIZE = 64; // See Duel::SetResponseBuffer
+
+class DuelScheduler::Task
+{
+public:
+	std::shared_ptr<Duel> duel;
+	std::atomic<int> state;
+	std::size_t worker; // Ran it last, it is scheduled there again
+
+	// Written by the thread that claimed it, before it is scheduled
+	bool hasResponse;
+	bool bufferResponse;
+	int integerResponse;
+	std::size_t responseLength;
+	unsigned char response[RESPONSE_SIZE];
+
+	Task(std::shared_ptr<Duel> duel, std::size_t worker) :
+		duel(std::move(duel)),
+		state(TASK_QUEUED),
+		worker(worker),
+		hasResponse(false),
+		bufferResponse(false),
+		integerResponse(0),
+		responseLength(0)
+	{}
+};
+
+// The owner takes duels from the front, others steal from the back
+struct DuelScheduler::Worker
+{
+	std::mutex mutex;
+	std::deque<Handle> tasks;
+	std::thread thread;
+};
+
+DuelScheduler::DuelScheduler(Listener listener, std::size_t count) :
+	listener(std::move(listener)),
+	queued(0),
+	sleeping(0),
+	stopping(false),
+	nextWorker(0)
+{
+	if(count == 0)
+		count = std::thread::hardware_concurrency();
+	if(count == 0)
+		count = 1;
+
+	for(std::size_t i = 0; i < count; ++i)
+		workers.emplace_back(new Worker());
+	for(std::size_t i = 0; i < count; ++i)
+		workers[i]->thread = std::thread(&DuelScheduler::Run, this, i);
+}
+
+DuelScheduler::~DuelScheduler()
+{
+	Stop();
+}
+
+void DuelScheduler::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(idleMutex);
+		stopping = true;
+	}
+	idle.notify_all();
+	for(auto& worker : workers)
+	{
+		if(worker->thread.joinable())
+			worker->thread.join();
+		std::lock_guard<std::mutex> lock(worker->mutex);
+		queued -= worker->tasks.size();
+		worker->tasks.clear();
+	}
+}
+
+DuelScheduler::Handle DuelScheduler::Add(std::shared_ptr<Duel> duel)
+{
+	const std::size_t worker = nextWorker++ % workers.size();
+	Handle task = std::make_shared<Task>(std::move(duel), worker);
+	Push(worker, task);
+	return task;
+}
+
+bool DuelScheduler::SetResponseInteger(const Handle& task, int value)
+{
+	const int claimed = Claim(task);
+	if(claimed < 0)
+		return false;
+	task->hasResponse = true;
+	task->bufferResponse = false;
+	task->integerResponse = value;
+	Release(task, claimed);
+	return true;
+}
+
+bool DuelScheduler::SetResponseBuffer(const Handle& task, const void* buffer, std::size_t length)
+{
+	if(length > RESPONSE_SIZE)
+	{
+		Logger::Warning(LogCategory::Duel, "Response of %u bytes is cut to %u",
+		                (unsigned int)length, (unsigned int)RESPONSE_SIZE);
+		length = RESPONSE_SIZE;
+	}
+	const int claimed = Claim(task);
+	if(claimed < 0)
+		return false;
+	task->hasResponse = true;
+	task->bufferResponse = true;
+	task->responseLength = length;
+	std::memcpy(task->response, buffer, length);
+	Release(task, claimed);
+	return true;
+}
+
+int DuelScheduler::Claim(const Handle& task)
+{
+	int state = task->state.load();
+	while(true)
+	{
+		int claimed;
+		if(state == TASK_WAITING)
+			claimed = TASK_RESPONDING;
+		else if(state == TASK_LISTENING)
+			claimed = TASK_RESPONDING_LISTENING;
+		else
+		{
+			Logger::Warning(LogCategory::Duel, "Response to a duel that is not waiting for one");
+			return -1;
+		}
+		if(task->state.compare_exchange_weak(state, claimed))
+			return claimed;
+	}
+}
+
+void DuelScheduler::Release(const Handle& task, int claimed)
+{
+	if(claimed == TASK_RESPONDING)
+	{
+		task->state.store(TASK_QUEUED);
+		Push(task->worker, task);
+	}
+	else
+	{
+		// The worker schedules it once the listener returns
+		task->state.store(TASK_ANSWERED);
+	}
+}
+
+std::size_t DuelScheduler::WorkerCount() const
+{
+	return workers.size();
+}
+
+std::size_t DuelScheduler::Queued() const
+{
+	return queued.load(std::memory_order_relaxed);
+}
+
+void DuelScheduler::Push(std::size_t worker, Handle task)
+{
+	{
+		std::lock_guard<std::mutex> lock(workers[worker]->mutex);
+		workers[worker]->tasks.push_back(std::move(task));
+	}
+	queued.fetch_add(1);
+	// Sleeping workers count themselves before checking queued, so either
+	// they see this task or this sees them
+	if(sleeping.load() > 0)
+	{
+		std::lock_guard<std::mutex> lock(idleMutex);
+		idle.notify_one();
+	}
+}
+
+DuelScheduler::Handle DuelScheduler::Pop(std::size_t worker)
+{
+	Handle task;
+	{
+		Worker& own = *workers[worker];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if(!own.tasks.empty())
+		{
+			task = std::move(own.tasks.front());
+			own.tasks.pop_front();
+		}
+	}
+
+	// Steal from the others, starting with the next one
+	for(std::size_t i = 1; !task && i < workers.size(); ++i)
+	{
+		Worker& victim = *workers[(worker + i) % workers.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if(!victim.tasks.empty())
+		{
+			task = std::move(victim.tasks.back());
+			victim.tasks.pop_back();
+		}
+	}
+
+	if(task)
+		queued.fetch_sub(1);
+	return task;
+}
+
+void DuelScheduler::Run(std::size_t worker)
+{
+	while(!stopping.load(std::memory_order_relaxed))
+	{
+		Handle task = Pop(worker);
+		if(task)
+		{
+			Process(worker, task);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(idleMutex);
+		sleeping.fetch_add(1);
+		idle.wait(lock, [this]() { return stopping.load() || queued.load() > 0; });
+		sleeping.fetch_sub(1);
+	}
+}
+
+void DuelScheduler::Process(std::size_t worker, const Handle& task)
+{
+	task->worker = worker;
+	task->state.store(TASK_RUNNING);
+
+	Duel& duel = *task->duel;
+	if(task->hasResponse)
+	{
+		if(task->bufferResponse)
+			duel.SetResponseBuffer(task->response, task->responseLength);
+		else
+			duel.SetResponseInteger(task->integerResponse);
+		task->hasResponse = false;
+	}
+
+	// Nobody can claim a running task, these cannot fail
+	const DuelMessage result = duel.Process();
+	int state = TASK_RUNNING;
+	if(result == DuelMessage::EndOfDuel)
+	{
+		task->state.compare_exchange_strong(state, TASK_ENDED);
+		if(listener)
+			listener(task, duel, result);
+		return;
+	}
+	task->state.compare_exchange_strong(state, TASK_LISTENING);
+
+	if(listener)
+		listener(task, duel, result);
+	while(true)
+	{
+		state = TASK_LISTENING;
+		if(task->state.compare_exchange_strong(state, TASK_WAITING))
+			return;
+		if(state == TASK_ANSWERED)
+		{
+			task->state.store(TASK_QUEUED);
+			Push(worker, task);
+			return;
+		}
+		// A response is being written
+		std::this_thread::yield();
+	}
+}
+
+} // namespace YGOpen
@@ -0,0 +1,76 @@
+#ifndef __DUEL_SCHEDULER_HPP__
+#define __DUEL_SCHEDULER_HPP__
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "duel.hpp"
+
+namespace YGOpen
+{
+
+// Runs duels on a fixed pool of threads. Each worker has its own queue
+// of duels ready to run; idle workers take duels from the others'.
+// A duel runs until Duel::Process stops, then waits for its response,
+// which schedules it again on the worker that ran it last.
+//
+// Nothing else may call into a scheduled duel, except from the listener.
+class DuelScheduler
+{
+public:
+	class Task;
+	typedef std::shared_ptr<Task> Handle;
+	// Called on the worker thread each time a duel stops, with either
+	// NeedResponse or EndOfDuel. Responses may be given from it already.
+	typedef std::function<void(const Handle& task, Duel& duel, DuelMessage result)> Listener;
+
+	// As many workers as the hardware can run threads if workers is 0
+	explicit DuelScheduler(Listener listener, std::size_t workers = 0);
+	~DuelScheduler();
+
+	// Schedules a started duel
+	Handle Add(std::shared_ptr<Duel> duel);
+
+	// Answer a duel waiting for a response, which is scheduled again.
+	// Return false if the duel was not waiting for one: it ended, or it
+	// is running and did not ask yet.
+	bool SetResponseInteger(const Handle& task, int value);
+	bool SetResponseBuffer(const Handle& task, const void* buffer, std::size_t length);
+
+	std::size_t WorkerCount() const;
+	// Duels ready to run, waiting for a worker
+	std::size_t Queued() const;
+
+	// Finishes the duels being processed and stops every worker. Queued
+	// duels are not processed anymore.
+	void Stop();
+private:
+	struct Worker;
+
+	Listener listener;
+	std::vector<std::unique_ptr<Worker>> workers;
+	std::atomic<std::size_t> queued;
+	std::atomic<std::size_t> sleeping;
+	std::atomic<bool> stopping;
+	std::atomic<std::size_t> nextWorker; // For duels added
+	std::mutex idleMutex;
+	std::condition_variable idle;
+
+	void Push(std::size_t worker, Handle task);
+	Handle Pop(std::size_t worker);
+	int Claim(const Handle& task);
+	void Release(const Handle& task, int claimed);
+	void Run(std::size_t worker);
+	void Process(std::size_t worker, const Handle& task);
+
+	DuelScheduler(const DuelScheduler&) = delete;
+	DuelScheduler& operator=(const DuelScheduler&) = delete;
+};
+
+} // namespace YGOpen
+
+#endif // __DUEL_SCHEDULER_HPP__
@@ -0,0 +1,132 @@
+#include "duel_session.hpp"
+
+#include "util/logger.hpp"
+
+namespace YGOpen
+{
+
+static const int SESSION_IDLE = 0; // Not started or answered, not run yet
+static const int SESSION_RUNNING = 1;
+static const int SESSION_WAITING = 2;
+static const int SESSION_ENDED = 3;
+
+static const std::size_t RESPONSE_SIZE = 64; // See Duel::SetResponseBuffer
+
+DuelSession::DuelSession(Duel& duel) :
+	duel(duel),
+	state(SESSION_IDLE),
+	inListener(false),
+	answered(false),
+	awaiting(nullptr)
+{}
+
+DuelSession::~DuelSession()
+{
+#ifdef YGOPEN_COROUTINES
+	if(awaiting)
+		std::coroutine_handle<>::from_address(awaiting).destroy();
+#endif
+}
+
+Duel& DuelSession::GetDuel()
+{
+	return duel;
+}
+
+bool DuelSession::Waiting() const
+{
+	return state == SESSION_WAITING;
+}
+
+bool DuelSession::Ended() const
+{
+	return state == SESSION_ENDED;
+}
+
+std::pair<void*, std::size_t> DuelSession::Prompt() const
+{
+	if(state != SESSION_WAITING)
+		return std::make_pair(nullptr, std::size_t(0));
+	return duel.LastMessage();
+}
+
+void DuelSession::Start(Listener listener)
+{
+	this->listener = std::move(listener);
+	Resume();
+}
+
+bool DuelSession::RespondInteger(int value)
+{
+	if(state != SESSION_WAITING)
+	{
+		Logger::Warning(LogCategory::Duel, "Response to a duel that is not waiting for one");
+		return false;
+	}
+	duel.SetResponseInteger(value);
+	state = SESSION_IDLE;
+	Resume();
+	return true;
+}
+
+bool DuelSession::RespondBuffer(const void* buffer, std::size_t length)
+{
+	if(state != SESSION_WAITING)
+	{
+		Logger::Warning(LogCategory::Duel, "Response to a duel that is not waiting for one");
+		return false;
+	}
+	if(length > RESPONSE_SIZE)
+	{
+		Logger::Warning(LogCategory::Duel, "Response of %u bytes is bigger than %u",
+		                (unsigned int)length, (unsigned int)RESPONSE_SIZE);
+		return false;
+	}
+	duel.SetResponseBuffer(buffer, length);
+	state = SESSION_IDLE;
+	Resume();
+	return true;
+}
+
+DuelMessage DuelSession::Run()
+{
+	if(state == SESSION_ENDED)
+		return DuelMessage::EndOfDuel;
+	state = SESSION_RUNNING;
+	const DuelMessage result = duel.Process();
+	state = (result == DuelMessage::EndOfDuel) ? SESSION_ENDED : SESSION_WAITING;
+	return result;
+}
+
+void DuelSession::Resume()
+{
+	// Answered from the listener: the loop below runs it once it returns,
+	// instead of nesting a call per prompt
+	if(inListener)
+	{
+		answered = true;
+		return;
+	}
+#ifdef YGOPEN_COROUTINES
+	if(awaiting)
+	{
+		auto handle = std::coroutine_handle<>::from_address(awaiting);
+		awaiting = nullptr;
+		handle.resume();
+		return;
+	}
+#endif
+	// Without a listener, a coroutine answered before awaiting Next again
+	if(!listener)
+		return;
+	do
+	{
+		answered = false;
+		const DuelMessage result = Run();
+		inListener = true;
+		listener(*this, result);
+		inListener = false;
+	} while(answered);
+}
+
+} // namespace YGOpen
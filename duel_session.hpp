@@ -0,0 +1,95 @@
+#ifndef __DUEL_SESSION_HPP__
+#define __DUEL_SESSION_HPP__
+#include <cstddef>
+#include <functional>
+#include <utility>
+#ifdef YGOPEN_COROUTINES
+#include <coroutine>
+#include <exception>
+#endif
+
+#include "duel.hpp"
+
+namespace YGOpen
+{
+
+// Drives a started duel from one prompt (a message asking for a response)
+// to the next. Answering a prompt runs the duel up to the next one right
+// away, on the answering thread.
+//
+// Either a listener is given to Start, or a coroutine awaits Next
+// (YGOPEN_COROUTINES, C++20). Calls to a session must not overlap.
+class DuelSession
+{
+public:
+	// Called each time the duel stops, with either NeedResponse or
+	// EndOfDuel. Responses may be given from it already.
+	typedef std::function<void(DuelSession& session, DuelMessage result)> Listener;
+
+	explicit DuelSession(Duel& duel);
+	~DuelSession();
+
+	Duel& GetDuel();
+	// Whether a prompt is waiting for its response
+	bool Waiting() const;
+	bool Ended() const;
+	// Message of the pending prompt, see Duel::LastMessage
+	std::pair<void*, std::size_t> Prompt() const;
+
+	// Runs the duel until it stops and calls listener, which is called
+	// again every time a response runs it until it stops.
+	void Start(Listener listener);
+
+	// Answer the pending prompt. Return false if there is none, or if
+	// the buffer is bigger than the core takes (64 bytes).
+	bool RespondInteger(int value);
+	bool RespondBuffer(const void* buffer, std::size_t length);
+
+#ifdef YGOPEN_COROUTINES
+	// Coroutine type for code awaiting Next. It starts right away and is
+	// destroyed when it returns, or with the session if it never does.
+	struct Task
+	{
+		struct promise_type
+		{
+			Task get_return_object() { return Task(); }
+			std::suspend_never initial_suspend() noexcept { return {}; }
+			std::suspend_never final_suspend() noexcept { return {}; }
+			void return_void() {}
+			void unhandled_exception() { std::terminate(); }
+		};
+	};
+
+	class Awaiter
+	{
+		DuelSession& session;
+	public:
+		explicit Awaiter(DuelSession& session) : session(session) {}
+		bool await_ready() const { return !session.Waiting(); }
+		void await_suspend(std::coroutine_handle<> handle) { session.awaiting = handle.address(); }
+		DuelMessage await_resume() { return session.Run(); }
+	};
+
+	// co_await session.Next() runs the duel until it stops and gives why.
+	// While the last prompt is not answered it suspends; the response
+	// resumes it, inside RespondInteger or RespondBuffer.
+	Awaiter Next() { return Awaiter(*this); }
+#endif
+private:
+	Duel& duel;
+	Listener listener;
+	int state;
+	bool inListener; // Responses given from it are run by Start's loop
+	bool answered;
+	void* awaiting; // Suspended coroutine, if any
+
+	DuelMessage Run();
+	void Resume();
+
+	DuelSession(const DuelSession&) = delete;
+	DuelSession& operator=(const DuelSession&) = delete;
+};
+
+} // namespace YGOpen
+
+#endif // __DUEL_SESSION_HPP__
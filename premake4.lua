@@ -1,6 +1,38 @@
 local sqlite_dir = "../sqlite3"
 local json_dir   = "../json-develop/include"
 
+-- Links the given core library into every program and calls it directly
+-- (see core_calls.hpp), instead of loading a core at runtime
+newoption({
+	trigger     = "static-core",
+	value       = "LIB",
+	description = "Link this core library statically instead of loading one at runtime"
+})
+local static_core = _OPTIONS["static-core"]
+
+-- Builds the library as C++20 with DuelSession's coroutine API; code
+-- including duel_session.hpp defines YGOPEN_COROUTINES as well
+newoption({
+	trigger     = "coroutines",
+	description = "Build with C++20 and the coroutine API of DuelSession"
+})
+local coroutines = _OPTIONS["coroutines"]
+local cpp_standard = coroutines and "c++20" or "c++11"
+
+-- Applies the option to the current project, programs also link the core
+local function use_static_core(program)
+	if static_core then
+		defines("YGOPEN_STATIC_CORE")
+		configuration("not windows")
+			buildoptions("-flto")
+			linkoptions("-flto")
+		configuration({})
+		if program then
+			links(static_core)
+		end
+	end
+end
+
 if os.get()=="windows" then
 	include(sqlite_dir)
 end
@@ -9,15 +41,93 @@ project("ygopen")
 	kind("StaticLib")
 	flags("ExtraWarnings")
 	files({"**.hpp", "**.cpp"})
+	excludes({"tools/**"})
 	links("sqlite3")
 
+	use_static_core(false)
+	if coroutines then
+		defines("YGOPEN_COROUTINES")
+	end
+
 	configuration("windows")
 		includedirs({sqlite_dir, json_dir})
 		defines({ "WIN32", "_WIN32", "NOMINMAX" })
 
 	configuration("not windows")
-		buildoptions({"-pedantic", "--std=c++11"})
-		links("dl")
+		buildoptions({"-pedantic", "--std=" .. cpp_standard})
+		links({"dl", "pthread"})
+
+	configuration("linux")
+		links("rt")
 
 	configuration("macosx")
 		includedirs(json_dir)
+
+configuration({})
+
+project("ygopen-snapshot")
+	kind("ConsoleApp")
+	flags("ExtraWarnings")
+	files({"tools/snapshot.cpp"})
+	links({"ygopen", "sqlite3"})
+
+	use_static_core(true)
+
+	configuration("windows")
+		includedirs({sqlite_dir})
+		defines({ "WIN32", "_WIN32", "NOMINMAX" })
+
+	configuration("not windows")
+		buildoptions({"-pedantic", "--std=c++11"})
+		links({"dl", "pthread"})
+
+configuration({})
+
+project("ygopen-script-archive")
+	kind("ConsoleApp")
+	flags("ExtraWarnings")
+	files({"tools/script_archive.cpp"})
+	links("ygopen")
+
+	use_static_core(true)
+
+	configuration("windows")
+		defines({ "WIN32", "_WIN32", "NOMINMAX" })
+
+	configuration("not windows")
+		buildoptions({"-pedantic", "--std=c++11"})
+		links("pthread")
+
+configuration({})
+
+project("ygopen-core-worker")
+	kind("ConsoleApp")
+	flags("ExtraWarnings")
+	files({"tools/core_worker.cpp"})
+	links({"ygopen", "sqlite3"})
+
+	use_static_core(true)
+
+	configuration("windows")
+		includedirs({sqlite_dir})
+		defines({ "WIN32", "_WIN32", "NOMINMAX" })
+
+	configuration("not windows")
+		buildoptions({"-pedantic", "--std=c++11"})
+		links({"dl", "pthread"})
+
+	configuration("linux")
+		links("rt")
+
+configuration({})
+
+project("ygopen-mock-core")
+	kind("SharedLib")
+	flags("ExtraWarnings")
+	files({"tools/mock_core.cpp"})
+
+	configuration("windows")
+		defines({ "WIN32", "_WIN32", "NOMINMAX" })
+
+	configuration("not windows")
+		buildoptions({"-pedantic", "--std=c++11"})
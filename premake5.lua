@@ -1,6 +1,35 @@
 local sqlite_dir = "../sqlite3"
 local json_dir   = "../json-develop/include"
 
+-- Links the given core library into every program and calls it directly
+-- (see core_calls.hpp), instead of loading a core at runtime
+newoption({
+	trigger     = "static-core",
+	value       = "LIB",
+	description = "Link this core library statically instead of loading one at runtime"
+})
+local static_core = _OPTIONS["static-core"]
+
+-- Builds the library as C++20 with DuelSession's coroutine API; code
+-- including duel_session.hpp defines YGOPEN_COROUTINES as well
+newoption({
+	trigger     = "coroutines",
+	description = "Build with C++20 and the coroutine API of DuelSession"
+})
+local coroutines = _OPTIONS["coroutines"]
+local cpp_standard = coroutines and "c++20" or "c++11"
+
+-- Applies the option to the current project, programs also link the core
+local function use_static_core(program)
+	if static_core then
+		defines("YGOPEN_STATIC_CORE")
+		flags("LinkTimeOptimization")
+		if program then
+			links(static_core)
+		end
+	end
+end
+
 if os.target()=="windows" then
 	include(sqlite_dir)
 end
@@ -9,8 +38,15 @@ project("ygopen")
 	kind("StaticLib")
 	warnings("Extra")
 	files({"**.hpp", "**.cpp"})
+	removefiles({"tools/**"})
 	links("sqlite3")
 
+	use_static_core(false)
+	if coroutines then
+		defines("YGOPEN_COROUTINES")
+		cppdialect("C++20")
+	end
+
 	filter("system:windows")
 		includedirs({sqlite_dir, json_dir})
 		defines({ "WIN32", "_WIN32", "NOMINMAX" })
@@ -19,8 +55,80 @@ project("ygopen")
 		characterset("ASCII")
 
 	filter("system:not windows")
-		buildoptions({"-pedantic", "-std=c++11"})
-		links("dl")
+		buildoptions({"-pedantic", "-std=" .. cpp_standard})
+		links({"dl", "pthread"})
+
+	filter("system:linux")
+		links("rt")
 
 	filter("system:macosx")
 		includedirs(json_dir)
+
+filter({})
+
+project("ygopen-snapshot")
+	kind("ConsoleApp")
+	warnings("Extra")
+	files({"tools/snapshot.cpp"})
+	links({"ygopen", "sqlite3"})
+
+	use_static_core(true)
+
+	filter("system:windows")
+		includedirs({sqlite_dir})
+		defines({ "WIN32", "_WIN32", "NOMINMAX" })
+
+	filter("system:not windows")
+		buildoptions({"-pedantic", "-std=c++11"})
+		links({"dl", "pthread"})
+
+filter({})
+
+project("ygopen-script-archive")
+	kind("ConsoleApp")
+	warnings("Extra")
+	files({"tools/script_archive.cpp"})
+	links("ygopen")
+
+	use_static_core(true)
+
+	filter("system:windows")
+		defines({ "WIN32", "_WIN32", "NOMINMAX" })
+
+	filter("system:not windows")
+		buildoptions({"-pedantic", "-std=c++11"})
+		links("pthread")
+
+filter({})
+
+project("ygopen-core-worker")
+	kind("ConsoleApp")
+	warnings("Extra")
+	files({"tools/core_worker.cpp"})
+	links({"ygopen", "sqlite3"})
+
+	use_static_core(true)
+
+	filter("system:windows")
+		includedirs({sqlite_dir})
+		defines({ "WIN32", "_WIN32", "NOMINMAX" })
+
+	filter("system:not windows")
+		buildoptions({"-pedantic", "-std=c++11"})
+		links({"dl", "pthread"})
+
+	filter("system:linux")
+		links("rt")
+
+filter({})
+
+project("ygopen-mock-core")
+	kind("SharedLib")
+	warnings("Extra")
+	files({"tools/mock_core.cpp"})
+
+	filter("system:windows")
+		defines({ "WIN32", "_WIN32", "NOMINMAX" })
+
+	filter("system:not windows")
+		buildoptions({"-pedantic", "-std=c++11"})
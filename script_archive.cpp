@@ -0,0 +1,299 @@
+#include "script_archive.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <map>
+
+#include "util/file_list.hpp"
+#include "util/logger.hpp"
+
+namespace YGOpen
+{
+
+// Archive file layout:
+//	ArchiveHeader
+//	Entry[entryCount]   at entriesOffset, sorted by name
+//	char[namesSize]     at namesOffset
+//	char[dataSize]      at dataOffset, the script bodies
+static const char ARCHIVE_MAGIC[8] = {'Y', 'G', 'O', 'S', 'A', 'R', 'C', '\0'};
+static const uint32_t ARCHIVE_VERSION = 2;
+static const uint32_t ARCHIVE_BYTE_ORDER = 0x01020304;
+
+struct ArchiveHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t byteOrder;
+	uint32_t entryCount;
+	uint32_t reserved;
+	char coreVersion[32]; // Null terminated, empty if the archive holds sources
+	uint64_t entriesOffset;
+	uint64_t namesOffset;
+	uint64_t namesSize;
+	uint64_t dataOffset;
+	uint64_t dataSize;
+};
+
+static inline uint64_t AlignOffset(uint64_t offset)
+{
+	return (offset + 7) & ~(uint64_t)7;
+}
+
+static inline int CompareName(const char* a, std::size_t aLength, const char* b, std::size_t bLength)
+{
+	const int result = std::memcmp(a, b, std::min(aLength, bLength));
+	if(result != 0)
+		return result;
+	return (aLength < bLength) ? -1 : (aLength > bLength) ? 1 : 0;
+}
+
+static bool ReadFile(const std::string& path, std::string& contents)
+{
+	std::FILE* fp = std::fopen(path.c_str(), "rb");
+	if(fp == nullptr)
+		return false;
+	char buffer[16384];
+	std::size_t read;
+	while((read = std::fread(buffer, 1, sizeof(buffer), fp)) > 0)
+		contents.append(buffer, read);
+	const bool ok = std::ferror(fp) == 0;
+	std::fclose(fp);
+	return ok;
+}
+
+ScriptArchive::ScriptArchive() :
+	coreVersion(),
+	entries(nullptr),
+	entryCount(0),
+	names(nullptr),
+	data(nullptr)
+{}
+
+uint64_t ScriptArchive::Hash(const void* data, std::size_t size)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	uint64_t h = 14695981039346656037ull; // FNV-1a
+	for(std::size_t i = 0; i < size; ++i)
+	{
+		h ^= bytes[i];
+		h *= 1099511628211ull;
+	}
+	return h;
+}
+
+bool ScriptArchive::Build(const char* path, const std::vector<std::string>& files,
+                          const std::string& coreVersion, const Compiler& compile)
+{
+	if(coreVersion.size() >= sizeof(ArchiveHeader::coreVersion))
+	{
+		Logger::Error(LogCategory::Script, "Core version tag too long: %s", coreVersion);
+		return false;
+	}
+
+	std::map<std::string, std::string> sorted; // File name -> path
+	for(auto& file : files)
+		sorted[FileName(file)] = file;
+
+	std::vector<Entry> index;
+	std::string nameBlob;
+	std::string dataBlob;
+	index.reserve(sorted.size());
+	for(auto& file : sorted)
+	{
+		Entry entry;
+		entry.nameOffset = (uint32_t)nameBlob.size();
+		entry.nameLength = (uint32_t)file.first.size();
+		entry.dataOffset = (uint32_t)dataBlob.size();
+		std::string source;
+		if(!ReadFile(file.second, source))
+		{
+			Logger::Error(LogCategory::Script, "Failed reading %s", file.second);
+			return false;
+		}
+		entry.sourceHash = Hash(source.data(), source.size());
+		if(compile)
+		{
+			std::string output;
+			if(!compile(file.second, output))
+			{
+				Logger::Error(LogCategory::Script, "Failed compiling %s", file.second);
+				return false;
+			}
+			dataBlob += output;
+		}
+		else
+		{
+			dataBlob += source;
+		}
+		if(dataBlob.size() > UINT32_MAX || nameBlob.size() + file.first.size() > UINT32_MAX)
+		{
+			Logger::Error(LogCategory::Script, "Too many scripts for a single archive");
+			return false;
+		}
+		entry.dataLength = (uint32_t)(dataBlob.size() - entry.dataOffset);
+		nameBlob += file.first;
+		index.push_back(entry);
+	}
+
+	ArchiveHeader header;
+	std::memset(&header, 0, sizeof(ArchiveHeader));
+	std::memcpy(header.magic, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC));
+	header.version = ARCHIVE_VERSION;
+	header.byteOrder = ARCHIVE_BYTE_ORDER;
+	header.entryCount = (uint32_t)index.size();
+	std::strcpy(header.coreVersion, coreVersion.c_str());
+	header.entriesOffset = AlignOffset(sizeof(ArchiveHeader));
+	header.namesOffset = AlignOffset(header.entriesOffset + index.size() * sizeof(Entry));
+	header.namesSize = nameBlob.size();
+	header.dataOffset = AlignOffset(header.namesOffset + nameBlob.size());
+	header.dataSize = dataBlob.size();
+
+	std::FILE* fp = std::fopen(path, "wb");
+	if(fp == nullptr)
+	{
+		Logger::Error(LogCategory::Script, "Failed opening %s for writing", path);
+		return false;
+	}
+
+	static const char padding[8] = {0};
+	uint64_t written = 0;
+	auto writeAt = [&](uint64_t offset, const void* ptr, std::size_t size) -> bool
+	{
+		if(offset > written && std::fwrite(padding, 1, (std::size_t)(offset - written), fp) != offset - written)
+			return false;
+		written = offset + size;
+		return size == 0 || std::fwrite(ptr, 1, size, fp) == size;
+	};
+
+	const bool ok = writeAt(0, &header, sizeof(ArchiveHeader)) &&
+	                writeAt(header.entriesOffset, index.data(), index.size() * sizeof(Entry)) &&
+	                writeAt(header.namesOffset, nameBlob.data(), nameBlob.size()) &&
+	                writeAt(header.dataOffset, dataBlob.data(), dataBlob.size());
+	if(std::fclose(fp) != 0 || !ok)
+	{
+		Logger::Error(LogCategory::Script, "Failed writing script archive %s", path);
+		return false;
+	}
+	return true;
+}
+
+bool ScriptArchive::Open(const char* path)
+{
+	Close();
+	if(!file.Open(path))
+		return false;
+
+	const char* base = (const char*)file.Data();
+	const uint64_t size = file.Size();
+	auto fits = [size](uint64_t offset, uint64_t length) -> bool
+	{
+		return offset <= size && length <= size - offset;
+	};
+
+	ArchiveHeader header;
+	if(size < sizeof(ArchiveHeader))
+	{
+		Logger::Error(LogCategory::Script, "Invalid script archive %s", path);
+		Close();
+		return false;
+	}
+	std::memcpy(&header, base, sizeof(ArchiveHeader));
+	if(std::memcmp(header.magic, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC)) != 0 ||
+	   header.version != ARCHIVE_VERSION ||
+	   header.byteOrder != ARCHIVE_BYTE_ORDER ||
+	   header.coreVersion[sizeof(header.coreVersion) - 1] != '\0' ||
+	   (header.entriesOffset & 7) != 0 ||
+	   !fits(header.entriesOffset, (uint64_t)header.entryCount * sizeof(Entry)) ||
+	   !fits(header.namesOffset, header.namesSize) ||
+	   !fits(header.dataOffset, header.dataSize))
+	{
+		Logger::Error(LogCategory::Script, "Invalid or incompatible script archive %s", path);
+		Close();
+		return false;
+	}
+
+	// Lookups rely on every entry being in bounds and sorted
+	const Entry* entriesBase = (const Entry*)(base + header.entriesOffset);
+	const char* namesBase = base + header.namesOffset;
+	for(std::size_t i = 0; i < header.entryCount; ++i)
+	{
+		const Entry& entry = entriesBase[i];
+		bool ok = entry.nameOffset <= header.namesSize &&
+		          entry.nameLength <= header.namesSize - entry.nameOffset &&
+		          entry.dataOffset <= header.dataSize &&
+		          entry.dataLength <= header.dataSize - entry.dataOffset;
+		if(ok && i > 0)
+		{
+			const Entry& prev = entriesBase[i - 1];
+			ok = CompareName(namesBase + prev.nameOffset, prev.nameLength,
+			                 namesBase + entry.nameOffset, entry.nameLength) < 0;
+		}
+		if(!ok)
+		{
+			Logger::Error(LogCategory::Script, "Invalid index entry in script archive %s", path);
+			Close();
+			return false;
+		}
+	}
+
+	std::memcpy(coreVersion, header.coreVersion, sizeof(coreVersion));
+	entries = entriesBase;
+	entryCount = header.entryCount;
+	names = namesBase;
+	data = (const unsigned char*)(base + header.dataOffset);
+	return true;
+}
+
+void ScriptArchive::Close()
+{
+	file.Close();
+	coreVersion[0] = '\0';
+	entries = nullptr;
+	entryCount = 0;
+	names = nullptr;
+	data = nullptr;
+}
+
+bool ScriptArchive::IsOpen() const
+{
+	return file.IsOpen();
+}
+
+std::size_t ScriptArchive::Size() const
+{
+	return entryCount;
+}
+
+const char* ScriptArchive::CoreVersion() const
+{
+	return coreVersion;
+}
+
+const unsigned char* ScriptArchive::Find(const std::string& name, int* length, uint64_t* sourceHash) const
+{
+	std::size_t first = 0;
+	std::size_t last = entryCount;
+	while(first < last)
+	{
+		const std::size_t middle = first + (last - first) / 2;
+		const Entry& entry = entries[middle];
+		const int result = CompareName(names + entry.nameOffset, entry.nameLength,
+		                               name.data(), name.size());
+		if(result == 0)
+		{
+			if(sourceHash != nullptr)
+				*sourceHash = entry.sourceHash;
+			*length = (int)entry.dataLength;
+			return data + entry.dataOffset;
+		}
+		if(result < 0)
+			first = middle + 1;
+		else
+			last = middle;
+	}
+	*length = 0;
+	return nullptr;
+}
+
+} // namespace YGOpen
@@ -0,0 +1,72 @@
+#ifndef __SCRIPT_ARCHIVE_HPP__
+#define __SCRIPT_ARCHIVE_HPP__
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "util/mapped_file.hpp"
+
+namespace YGOpen
+{
+
+// Every script packed in a single memory mapped file: a name index
+// sorted for binary search followed by the script bodies. Lookups
+// return pointers straight into the mapping, so no file is opened per
+// script and processes mapping the same archive share its pages.
+//
+// An archive can also hold precompiled bytecode instead of sources. Such
+// archives are tagged with the core version they were compiled for, and
+// every entry records the hash of the source it was compiled from.
+class ScriptArchive
+{
+	struct Entry
+	{
+		uint32_t nameOffset;
+		uint32_t nameLength;
+		uint32_t dataOffset;
+		uint32_t dataLength;
+		uint64_t sourceHash;
+	};
+
+	MappedFile file;
+	char coreVersion[32];
+	const Entry* entries;
+	std::size_t entryCount;
+	const char* names;
+	const unsigned char* data;
+
+	ScriptArchive(const ScriptArchive&) = delete;
+	ScriptArchive& operator=(const ScriptArchive&) = delete;
+public:
+	ScriptArchive();
+
+	// Turns the source at path into what gets stored, e.g. bytecode
+	typedef std::function<bool(const std::string& path, std::string& output)> Compiler;
+
+	// Packs the given files, stored by file name. If several files share
+	// a name the last one is kept. If compile is set its output is stored
+	// instead of the sources, tagged with coreVersion.
+	static bool Build(const char* path, const std::vector<std::string>& files,
+	                  const std::string& coreVersion = "", const Compiler& compile = nullptr);
+
+	// Hash used to match bytecode with its source
+	static uint64_t Hash(const void* data, std::size_t size);
+
+	bool Open(const char* path);
+	void Close();
+	bool IsOpen() const;
+	std::size_t Size() const;
+	// Empty for source archives
+	const char* CoreVersion() const;
+
+	// Contents of the script with the given file name, or nullptr.
+	// Valid until the archive is closed. sourceHash, if given, receives
+	// the hash of the source the contents come from.
+	const unsigned char* Find(const std::string& name, int* length, uint64_t* sourceHash = nullptr) const;
+};
+
+} // namespace YGOpen
+
+#endif // __SCRIPT_ARCHIVE_HPP__
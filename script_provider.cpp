@@ -0,0 +1,229 @@
+#include "script_provider.hpp"
+
+#include <cstdio>
+
+#include "util/file_list.hpp"
+#include "util/logger.hpp"
+
+namespace YGOpen
+{
+
+ScriptProvider::ScriptProvider(std::size_t cacheLimit) :
+	activeArchives(nullptr),
+	activeBytecode(nullptr),
+	cacheLimit(cacheLimit),
+	cacheUsed(0)
+{}
+
+std::size_t ScriptProvider::AddDirectory(const std::string& path)
+{
+	std::vector<std::string> files;
+	ListFiles(path, files);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	for(auto& file : files)
+		index[FileName(file)] = file;
+
+	// Cached scripts might come from a directory with less precedence
+	cache.clear();
+	cacheIndex.clear();
+	cacheUsed = 0;
+	return files.size();
+}
+
+bool ScriptProvider::AddArchive(const std::string& path)
+{
+	std::unique_ptr<ScriptArchive> archive(new ScriptArchive());
+	if(!archive->Open(path.c_str()))
+		return false;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	const ArchiveList* current = activeArchives.load(std::memory_order_relaxed);
+	std::unique_ptr<ArchiveList> next((current != nullptr) ? new ArchiveList(*current) : new ArchiveList());
+	next->push_back(archive.get());
+	archives.push_back(std::move(archive));
+	activeArchives.store(next.get(), std::memory_order_release);
+	archiveLists.push_back(std::move(next));
+	return true;
+}
+
+ScriptProvider::Script ScriptProvider::Load(const std::string& name) const
+{
+	std::string path = name;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto search = index.find(FileName(name));
+		if(search != index.end())
+			path = search->second;
+	}
+
+	std::FILE* fp = std::fopen(path.c_str(), "rb");
+	if(fp == nullptr)
+		return Script();
+
+	std::vector<unsigned char> contents;
+	unsigned char buffer[16384];
+	std::size_t read;
+	while((read = std::fread(buffer, 1, sizeof(buffer), fp)) > 0)
+		contents.insert(contents.end(), buffer, buffer + read);
+	std::fclose(fp);
+	return std::make_shared<const std::vector<unsigned char>>(std::move(contents));
+}
+
+std::size_t ScriptProvider::Footprint(const CachedScript& entry)
+{
+	return entry.name.size() + (entry.script ? entry.script->size() : 0);
+}
+
+// Must be called with mutex held
+void ScriptProvider::Insert(const std::string& name, const Script& script, uint64_t hash, bool hashed)
+{
+	if(cacheIndex.find(name) != cacheIndex.end())
+		return; // Another thread loaded it first
+
+	cache.push_front(CachedScript{name, script, hash, hashed});
+	cacheIndex[name] = cache.begin();
+	cacheUsed += Footprint(cache.front());
+
+	// Evict the least recently used scripts, but never the newest one
+	while(cacheUsed > cacheLimit && cache.size() > 1)
+	{
+		cacheUsed -= Footprint(cache.back());
+		cacheIndex.erase(cache.back().name);
+		cache.pop_back();
+	}
+}
+
+const unsigned char* ScriptProvider::Bytecode(const std::string& fileName, uint64_t sourceHash,
+                                              const unsigned char* source, int* length) const
+{
+	const ScriptArchive* archive = activeBytecode.load(std::memory_order_acquire);
+	if(archive == nullptr)
+		return source;
+	int bytecodeLength;
+	uint64_t compiledFrom;
+	const unsigned char* buffer = archive->Find(fileName, &bytecodeLength, &compiledFrom);
+	if(buffer == nullptr || compiledFrom != sourceHash)
+		return source; // Not compiled, or compiled from another version of the script
+	*length = bytecodeLength;
+	return buffer;
+}
+
+// Must be called with mutex held
+const unsigned char* ScriptProvider::Serve(const std::string& fileName, CachedScript& entry, int* length, Script& holder)
+{
+	if(!entry.script)
+	{
+		holder.reset();
+		*length = 0;
+		return nullptr;
+	}
+	// Sources are only hashed to be matched with bytecode
+	if(!entry.hashed && activeBytecode.load(std::memory_order_relaxed) != nullptr)
+	{
+		entry.hash = ScriptArchive::Hash(entry.script->data(), entry.script->size());
+		entry.hashed = true;
+	}
+	holder = entry.script;
+	*length = (int)entry.script->size();
+	return Bytecode(fileName, entry.hash, entry.script->data(), length);
+}
+
+const unsigned char* ScriptProvider::ReadScript(const char* name, int* length)
+{
+	// Keeps the last script handed to the core alive while it is being
+	// parsed, even if another thread evicts it from the cache meanwhile
+	static thread_local Script lastScript;
+	return ReadScript(name, length, lastScript);
+}
+
+const unsigned char* ScriptProvider::ReadScript(const char* name, int* length, Script& holder)
+{
+	const std::string key = name;
+	const std::string fileName = FileName(key);
+
+	// Served straight from the mapping, nothing to cache or lock
+	if(const ArchiveList* list = activeArchives.load(std::memory_order_acquire))
+	{
+		uint64_t hash;
+		for(auto it = list->rbegin(); it != list->rend(); ++it)
+		{
+			if(const unsigned char* buffer = (*it)->Find(fileName, length, &hash))
+			{
+				holder.reset();
+				return Bytecode(fileName, hash, buffer, length);
+			}
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto search = cacheIndex.find(key);
+		if(search != cacheIndex.end())
+		{
+			cache.splice(cache.begin(), cache, search->second);
+			return Serve(fileName, *search->second, length, holder);
+		}
+	}
+
+	// Read without holding the lock, other threads keep being served.
+	// Missing scripts are cached too, most cards do not have one.
+	Script script = Load(key);
+	const bool hashed = script && activeBytecode.load(std::memory_order_acquire) != nullptr;
+	const uint64_t hash = hashed ? ScriptArchive::Hash(script->data(), script->size()) : 0;
+	std::lock_guard<std::mutex> lock(mutex);
+	Insert(key, script, hash, hashed);
+	// Ours, or the one another thread loaded first. The newest entry is
+	// never evicted.
+	return Serve(fileName, *cacheIndex.find(key)->second, length, holder);
+}
+
+bool ScriptProvider::SetBytecodeArchive(const std::string& path, const std::string& coreVersion)
+{
+	std::unique_ptr<ScriptArchive> archive(new ScriptArchive());
+	if(!archive->Open(path.c_str()))
+		return false;
+	if(coreVersion != archive->CoreVersion())
+	{
+		Logger::Warning(LogCategory::Script, "Bytecode in %s was compiled for core version \"%s\", not \"%s\". Using sources instead.",
+		                path, archive->CoreVersion(), coreVersion);
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	// Bytecode handed out before might still be in use
+	if(bytecode)
+		retiredBytecode.push_back(std::move(bytecode));
+	bytecode = std::move(archive);
+	activeBytecode.store(bytecode.get(), std::memory_order_release);
+	return true;
+}
+
+std::size_t ScriptProvider::Warm(const std::vector<std::string>& names)
+{
+	std::size_t found = 0;
+	int length;
+	Script holder; // Not the calling thread's, a core might be using it
+	for(auto& name : names)
+	{
+		if(ReadScript(name.c_str(), &length, holder) != nullptr)
+			++found;
+	}
+	return found;
+}
+
+std::size_t ScriptProvider::GetCacheUsage() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return cacheUsed;
+}
+
+void ScriptProvider::ClearCache()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	cache.clear();
+	cacheIndex.clear();
+	cacheUsed = 0;
+}
+
+} // namespace YGOpen
@@ -0,0 +1,94 @@
+#ifndef __SCRIPT_PROVIDER_HPP__
+#define __SCRIPT_PROVIDER_HPP__
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "script_archive.hpp"
+
+namespace YGOpen
+{
+
+// Serves scripts to the core's script reader. Script directories are
+// indexed once, and script contents are kept in a cache shared by every
+// thread, bounded by cacheLimit bytes, so a cache hit touches no files.
+class ScriptProvider
+{
+public:
+	// Keeps a script read from a directory alive, see ReadScript
+	typedef std::shared_ptr<const std::vector<unsigned char>> Script;
+private:
+	struct CachedScript
+	{
+		std::string name;
+		Script script; // nullptr if the script does not exist
+		uint64_t hash; // See ScriptArchive::Hash, only set with bytecode
+		bool hashed;
+	};
+
+	// Archives are read without locking: AddArchive publishes a new list
+	// and every list is kept, they are only a few pointers
+	typedef std::vector<const ScriptArchive*> ArchiveList;
+	std::vector<std::unique_ptr<ScriptArchive>> archives;
+	std::vector<std::unique_ptr<const ArchiveList>> archiveLists;
+	std::atomic<const ArchiveList*> activeArchives;
+	std::unique_ptr<ScriptArchive> bytecode;
+	std::vector<std::unique_ptr<ScriptArchive>> retiredBytecode;
+	std::atomic<const ScriptArchive*> activeBytecode;
+	std::unordered_map<std::string, std::string> index; // File name -> path
+	std::size_t cacheLimit;
+	std::size_t cacheUsed;
+	mutable std::mutex mutex;
+	std::list<CachedScript> cache; // Most recently used first
+	std::unordered_map<std::string, std::list<CachedScript>::iterator> cacheIndex;
+
+	Script Load(const std::string& name) const;
+	void Insert(const std::string& name, const Script& script, uint64_t hash, bool hashed);
+	const unsigned char* Bytecode(const std::string& fileName, uint64_t sourceHash,
+	                              const unsigned char* source, int* length) const;
+	const unsigned char* Serve(const std::string& fileName, CachedScript& entry, int* length, Script& holder);
+	static std::size_t Footprint(const CachedScript& entry);
+public:
+	explicit ScriptProvider(std::size_t cacheLimit = 64 * 1024 * 1024);
+
+	// Indexes every file under path, recursively. Files found in
+	// directories added later take precedence. Returns how many were found.
+	std::size_t AddDirectory(const std::string& path);
+
+	// Maps a script archive (see ScriptArchive). Archives take precedence
+	// over directories, and archives added later over earlier ones.
+	bool AddArchive(const std::string& path);
+
+	// Serves precompiled bytecode from the given archive in place of the
+	// sources it was compiled from. Scripts whose source changed since,
+	// or which are missing from it, are still served as source. Fails if
+	// the archive was compiled for another core version (see
+	// CoreInterface::GetVersion).
+	bool SetBytecodeArchive(const std::string& path, const std::string& coreVersion);
+
+	// Contents of the script, looked up by file name in the archives, then
+	// in the indexed directories or else opened as given. Returns nullptr
+	// if not found. Scripts from archives and bytecode stay valid as long
+	// as the provider, those from directories as long as holder keeps them
+	// (it is reset otherwise). Archive hits take no lock.
+	const unsigned char* ReadScript(const char* name, int* length, Script& holder);
+	// Same, held until the calling thread reads another script this way
+	const unsigned char* ReadScript(const char* name, int* length);
+
+	// Loads the given scripts ahead of time, e.g. those of Duel::DeckScripts
+	// while a match is being set up. Returns how many were found.
+	std::size_t Warm(const std::vector<std::string>& names);
+
+	std::size_t GetCacheUsage() const;
+	void ClearCache();
+};
+
+} // namespace YGOpen
+
+#endif // __SCRIPT_PROVIDER_HPP__
@@ -0,0 +1,44 @@
+#include "setcode.hpp"
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define YGOPEN_SETCODE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace YGOpen
+{
+
+void MatchSetCards(const unsigned long long* setcodes, std::size_t count, unsigned int setcode, uint64_t* result)
+{
+	std::memset(result, 0, ((count + 63) / 64) * sizeof(uint64_t));
+	std::size_t i = 0;
+
+#ifdef YGOPEN_SETCODE_SSE2
+	// Two cards (eight 16-bit codes) per iteration
+	const __m128i typeMask = _mm_set1_epi16(0x0FFF);
+	const __m128i settype = _mm_set1_epi16((short)(setcode & 0x0FFF));
+	const __m128i setsubtype = _mm_set1_epi16((short)(setcode & 0xF000));
+	const __m128i zero = _mm_setzero_si128();
+	for(; i + 2 <= count; i += 2)
+	{
+		const __m128i codes = _mm_loadu_si128((const __m128i*)(setcodes + i));
+		const __m128i sameType = _mm_cmpeq_epi16(_mm_and_si128(codes, typeMask), settype);
+		const __m128i hasSubtype = _mm_cmpeq_epi16(_mm_and_si128(codes, setsubtype), setsubtype);
+		const __m128i empty = _mm_cmpeq_epi16(codes, zero);
+		const __m128i match = _mm_andnot_si128(empty, _mm_and_si128(sameType, hasSubtype));
+		const unsigned int mask = (unsigned int)_mm_movemask_epi8(match);
+		const uint64_t bits = (uint64_t)((mask & 0x00FF) != 0) | ((uint64_t)((mask & 0xFF00) != 0) << 1);
+		result[i / 64] |= bits << (i % 64);
+	}
+#endif
+
+	for(; i < count; ++i)
+	{
+		if(IsSetCard(setcodes[i], setcode))
+			result[i / 64] |= (uint64_t)1 << (i % 64);
+	}
+}
+
+} // namespace YGOpen
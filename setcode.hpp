@@ -0,0 +1,34 @@
+#ifndef __SETCODE_HPP__
+#define __SETCODE_HPP__
+#include <cstddef>
+#include <cstdint>
+
+namespace YGOpen
+{
+
+// CardData::setcode packs up to four 16-bit archetype codes. The low 12
+// bits of each one are the archetype and the high 4 bits mark
+// sub-archetypes, a card belongs to archetype X if any of its codes has
+// the same low 12 bits and at least the sub-archetype bits of X.
+inline bool IsSetCard(unsigned long long setcodes, unsigned int setcode)
+{
+	const unsigned int settype = setcode & 0x0FFF;
+	const unsigned int setsubtype = setcode & 0xF000;
+	while(setcodes != 0)
+	{
+		const unsigned int code = setcodes & 0xFFFF;
+		if(code != 0 && (code & 0x0FFF) == settype && (code & setsubtype) == setsubtype)
+			return true;
+		setcodes >>= 16;
+	}
+	return false;
+}
+
+// Tests setcode against count packed setcodes at once, setting bit i of
+// result (count rounded up to 64 bits) when setcodes[i] matches.
+// Uses SSE2 when available.
+void MatchSetCards(const unsigned long long* setcodes, std::size_t count, unsigned int setcode, uint64_t* result);
+
+} // namespace YGOpen
+
+#endif // __SETCODE_HPP__
@@ -0,0 +1,65 @@
+// Hosts a core for a CoreSandbox, which starts it.
+// Usage: ygopen-core-worker <shared memory> <core> [-s <snapshot>] [-d <database>]... [-p <script directory>]... [-a <script archive>]...
+// Cards and scripts are read the same way a ScriptProvider and a
+// DatabaseManager set up with these would in process, in the given order.
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../core_auxiliary.hpp"
+#include "../core_interface.hpp"
+#include "../core_sandbox.hpp"
+#include "../database_manager.hpp"
+#include "../script_provider.hpp"
+#include "../util/logger.hpp"
+
+int main(int argc, char* argv[])
+{
+	if(argc < 3 || (argc - 3) % 2 != 0)
+	{
+		std::printf("Usage: %s <shared memory> <core> [-s <snapshot>] [-d <database>]... "
+		            "[-p <script directory>]... [-a <script archive>]...\n", argv[0]);
+		return 1;
+	}
+
+	YGOpen::DatabaseManager dbm;
+	YGOpen::ScriptProvider sp;
+	std::vector<std::string> databases;
+	for(int i = 3; i + 1 < argc; i += 2)
+	{
+		const char* value = argv[i + 1];
+		bool loaded = true;
+		if(std::strcmp(argv[i], "-s") == 0)
+			loaded = dbm.LoadSnapshot(value);
+		else if(std::strcmp(argv[i], "-d") == 0)
+			databases.push_back(value);
+		else if(std::strcmp(argv[i], "-p") == 0)
+			sp.AddDirectory(value);
+		else if(std::strcmp(argv[i], "-a") == 0)
+			loaded = sp.AddArchive(value);
+		else
+		{
+			std::printf("Unknown option %s\n", argv[i]);
+			return 1;
+		}
+		if(!loaded)
+			return 1;
+	}
+	if(!databases.empty() && !dbm.LoadDatabases(databases))
+		return 1;
+
+	YGOpen::CoreInterface core(false);
+	if(!core.LoadCore(argv[2]))
+		return 1;
+	core.set_script_reader(&YGOpen::CoreAuxiliary::CoreScriptReader);
+	core.set_card_reader(&YGOpen::CoreAuxiliary::CoreCardReader);
+	core.set_message_handler(&YGOpen::CoreAuxiliary::CoreMessageHandler);
+	YGOpen::CoreAuxiliary::SetCore(&core);
+	YGOpen::CoreAuxiliary::SetDatabaseManager(&dbm);
+	YGOpen::CoreAuxiliary::SetScriptProvider(&sp);
+
+	const int code = YGOpen::CoreSandbox::Serve(argv[1], core);
+	YGOpen::Logger::Flush();
+	return code;
+}
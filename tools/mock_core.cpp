@@ -0,0 +1,490 @@
+// Stand-in for the core, for benchmarking and load testing everything
+// around it. Exports the functions CoreInterface::LoadCore expects and
+// plays seeded, made-up duels: turns of draws, summons, moves, chains
+// and attacks, stopping for selections, until a player wins. The same
+// seed and settings always produce the same messages.
+//
+// Settings are read from the YGOPEN_MOCK_CORE environment variable when
+// a duel is created, as comma separated key=value pairs:
+//	turns=N    Turns before the duel is won (20)
+//	actions=N  Average actions per turn (8)
+//	chain=P    Percent of actions that start a chain (30)
+//	select=P   Percent of actions that ask for a response (50)
+//	batch=N    Most events returned by one call to process (8)
+//	work=N     Nanoseconds of busy work per call to process (0)
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../card.hpp"
+#include "../enums/core_message.hpp"
+
+#ifdef _WIN32
+#define MOCK_EXPORT extern "C" __declspec(dllexport)
+#else
+#define MOCK_EXPORT extern "C" __attribute__((visibility("default")))
+#endif
+
+typedef unsigned char* (*script_reader)(const char*, int*);
+typedef unsigned int (*card_reader)(unsigned int, YGOpen::CardData*);
+typedef unsigned int (*message_handler)(void*, unsigned int);
+
+namespace
+{
+
+struct MockSettings
+{
+	unsigned int turns;
+	unsigned int actions;
+	unsigned int chain;
+	unsigned int select;
+	unsigned int batch;
+	unsigned int work;
+};
+
+MockSettings ReadSettings()
+{
+	MockSettings settings = {20, 8, 30, 50, 8, 0};
+	const char* env = std::getenv("YGOPEN_MOCK_CORE");
+	if(env == nullptr)
+		return settings;
+
+	std::string spec(env);
+	std::size_t start = 0;
+	while(start < spec.size())
+	{
+		std::size_t end = spec.find(',', start);
+		if(end == std::string::npos)
+			end = spec.size();
+		const std::string pair = spec.substr(start, end - start);
+		const std::size_t equals = pair.find('=');
+		if(equals != std::string::npos)
+		{
+			const std::string key = pair.substr(0, equals);
+			const unsigned int value = (unsigned int)std::strtoul(pair.c_str() + equals + 1, nullptr, 10);
+			if(key == "turns")
+				settings.turns = value;
+			else if(key == "actions")
+				settings.actions = value;
+			else if(key == "chain")
+				settings.chain = value;
+			else if(key == "select")
+				settings.select = value;
+			else if(key == "batch")
+				settings.batch = value;
+			else if(key == "work")
+				settings.work = value;
+		}
+		start = end + 1;
+	}
+	if(settings.batch == 0)
+		settings.batch = 1;
+	return settings;
+}
+
+// Locations, as the core numbers them
+const uint8_t LOCATION_DECK = 0x01;
+const uint8_t LOCATION_HAND = 0x02;
+const uint8_t LOCATION_MZONE = 0x04;
+const uint8_t LOCATION_GRAVE = 0x10;
+
+const uint16_t PHASE_DRAW = 0x01;
+const uint16_t PHASE_MAIN1 = 0x04;
+const uint16_t PHASE_BATTLE = 0x80;
+const uint16_t PHASE_END = 0x200;
+
+// Stops filling a batch past this, get_message must fit DUEL_BUFFER_SIZE
+const std::size_t BATCH_BYTES = 2048;
+
+struct MockCard
+{
+	unsigned int code;
+	uint8_t controller;
+	uint8_t location;
+	uint8_t sequence;
+};
+
+struct MockDuel
+{
+	MockSettings settings;
+	std::mt19937 rng;
+	unsigned int turn;
+	unsigned int actionsLeft;
+	int lp[2];
+	bool ended;
+	bool waiting; // For a response to the last selection
+	std::vector<MockCard> cards;
+	std::vector<unsigned char> messages; // Until get_message
+};
+
+script_reader scriptReader = nullptr;
+card_reader cardReader = nullptr;
+message_handler messageHandler = nullptr;
+
+class Writer
+{
+	std::vector<unsigned char>& out;
+public:
+	explicit Writer(std::vector<unsigned char>& out) : out(out) {}
+
+	Writer& Message(CoreMessage message)
+	{
+		return U8((uint8_t)message);
+	}
+	Writer& U8(uint8_t value)
+	{
+		out.push_back(value);
+		return *this;
+	}
+	Writer& U16(uint16_t value)
+	{
+		out.push_back((unsigned char)value);
+		out.push_back((unsigned char)(value >> 8));
+		return *this;
+	}
+	Writer& U32(uint32_t value)
+	{
+		for(int i = 0; i < 4; ++i)
+			out.push_back((unsigned char)(value >> (8 * i)));
+		return *this;
+	}
+	Writer& Zero(std::size_t count)
+	{
+		out.insert(out.end(), count, 0);
+		return *this;
+	}
+	// controller, location, sequence, position
+	Writer& Location(const MockCard& card)
+	{
+		return U8(card.controller).U8(card.location).U8(card.sequence).U8(0x1);
+	}
+};
+
+unsigned int Random(MockDuel& duel, unsigned int bound)
+{
+	return (bound == 0) ? 0 : (unsigned int)(duel.rng() % bound);
+}
+
+bool Chance(MockDuel& duel, unsigned int percent)
+{
+	return Random(duel, 100) < percent;
+}
+
+MockCard& RandomCard(MockDuel& duel)
+{
+	if(duel.cards.empty())
+		duel.cards.push_back(MockCard{10000, 0, LOCATION_DECK, 0});
+	return duel.cards[Random(duel, (unsigned int)duel.cards.size())];
+}
+
+int CurrentPlayer(const MockDuel& duel)
+{
+	return (int)(duel.turn % 2);
+}
+
+void WriteMove(MockDuel& duel, Writer& w, uint8_t location)
+{
+	MockCard& card = RandomCard(duel);
+	w.Message(CoreMessage::Move).U32(card.code).Location(card);
+	card.location = location;
+	card.sequence = (uint8_t)Random(duel, 5);
+	w.Location(card).U32(0x40); // Reason
+	w.Zero(28 - 16);
+}
+
+void WriteSummon(MockDuel& duel, Writer& w)
+{
+	MockCard& card = RandomCard(duel);
+	card.controller = (uint8_t)CurrentPlayer(duel);
+	card.location = LOCATION_MZONE;
+	card.sequence = (uint8_t)Random(duel, 5);
+	const bool special = Chance(duel, 50);
+	w.Message(special ? CoreMessage::SpSummoning : CoreMessage::Summoning).U32(card.code).Location(card).Zero(14 - 8);
+	w.Message(special ? CoreMessage::SpSummoned : CoreMessage::Summoned);
+}
+
+void WriteDamage(MockDuel& duel, Writer& w, int player)
+{
+	const int amount = (int)(100 * (1 + Random(duel, 30)));
+	duel.lp[player] -= amount;
+	if(duel.lp[player] < 0)
+		duel.lp[player] = 0;
+	w.Message(CoreMessage::Damage).U8((uint8_t)player).U32((uint32_t)amount);
+	w.Message(CoreMessage::LpUpdate).U8((uint8_t)player).U32((uint32_t)duel.lp[player]);
+}
+
+void WriteChain(MockDuel& duel, Writer& w)
+{
+	const unsigned int links = 1 + Random(duel, 3);
+	for(unsigned int i = 0; i < links; ++i)
+	{
+		MockCard& card = RandomCard(duel);
+		w.Message(CoreMessage::Chaining).U32(card.code).Location(card).Zero(26 - 8);
+		w.Message(CoreMessage::Chained).U8((uint8_t)(i + 1));
+	}
+	for(unsigned int i = links; i > 0; --i)
+	{
+		w.Message(CoreMessage::ChainSolving).U8((uint8_t)i);
+		if(Chance(duel, 50))
+			WriteMove(duel, w, LOCATION_GRAVE);
+		else
+			WriteDamage(duel, w, 1 - CurrentPlayer(duel));
+		w.Message(CoreMessage::ChainSolved).U8((uint8_t)i);
+	}
+	w.Message(CoreMessage::ChainEnd);
+}
+
+void WriteAttack(MockDuel& duel, Writer& w)
+{
+	MockCard& attacker = RandomCard(duel);
+	MockCard& target = RandomCard(duel);
+	w.Message(CoreMessage::Attack).Location(attacker).Location(target).Zero(20 - 8);
+	w.Message(CoreMessage::Battle).Location(attacker).U32(1800).U32(1200).U8(0).Location(target).U32(1500).U32(1000).U8(0).Zero(38 - 26);
+	WriteDamage(duel, w, 1 - CurrentPlayer(duel));
+}
+
+// A selection, always the last message of a batch
+void WriteSelect(MockDuel& duel, Writer& w)
+{
+	const int player = CurrentPlayer(duel);
+	switch(Random(duel, 3))
+	{
+		case 0:
+		{
+			// Summonable, special summonable, repositionable, monster and
+			// spell settable cards, then activatable ones, then whether
+			// the player can go to battle, to end or shuffle the hand
+			w.Message(CoreMessage::SelectIdleCmd).U8((uint8_t)player);
+			for(int i = 0; i < 6; ++i)
+			{
+				const unsigned int count = Random(duel, 3);
+				w.U8((uint8_t)count);
+				for(unsigned int j = 0; j < count; ++j)
+				{
+					w.U32(RandomCard(duel).code).Location(RandomCard(duel));
+					if(i == 5)
+						w.U32(0); // Effect description
+				}
+			}
+			w.U8(1).U8(1).U8(0);
+			break;
+		}
+		case 1:
+			w.Message(CoreMessage::SelectChain).U8((uint8_t)player).U8(0).U8(0).U32(0).U32(0);
+			break;
+		default:
+		{
+			const unsigned int count = 1 + Random(duel, 5);
+			w.Message(CoreMessage::SelectCard).U8((uint8_t)player).U8(0).U8(1).U8(1).U8((uint8_t)count);
+			for(unsigned int i = 0; i < count; ++i)
+				w.U32(RandomCard(duel).code).Location(RandomCard(duel));
+			break;
+		}
+	}
+	duel.waiting = true;
+}
+
+void WriteTurn(MockDuel& duel, Writer& w)
+{
+	++duel.turn;
+	duel.actionsLeft = 1 + Random(duel, 2 * duel.settings.actions);
+	const int player = CurrentPlayer(duel);
+	w.Message(CoreMessage::NewTurn).U8((uint8_t)player);
+	w.Message(CoreMessage::NewPhase).U16(PHASE_DRAW);
+	w.Message(CoreMessage::Draw).U8((uint8_t)player).U8(1).U32(RandomCard(duel).code);
+	w.Message(CoreMessage::NewPhase).U16(PHASE_MAIN1);
+}
+
+// Appends the messages of one event
+void Step(MockDuel& duel)
+{
+	Writer w(duel.messages);
+	if(duel.lp[0] == 0 || duel.lp[1] == 0 || duel.turn > duel.settings.turns)
+	{
+		const int winner = (duel.lp[0] == 0) ? 1 : (duel.lp[1] == 0) ? 0 : (int)Random(duel, 2);
+		w.Message(CoreMessage::Win).U8((uint8_t)winner).U8(0);
+		duel.ended = true;
+		return;
+	}
+	if(duel.actionsLeft == 0)
+	{
+		w.Message(CoreMessage::NewPhase).U16(PHASE_END);
+		WriteTurn(duel, w);
+		return;
+	}
+
+	--duel.actionsLeft;
+	if(Chance(duel, duel.settings.chain))
+		WriteChain(duel, w);
+	else switch(Random(duel, 5))
+	{
+		case 0: WriteSummon(duel, w); break;
+		case 1: WriteMove(duel, w, LOCATION_HAND); break;
+		case 2: w.Message(CoreMessage::NewPhase).U16(PHASE_BATTLE); WriteAttack(duel, w); break;
+		case 3: w.Message(CoreMessage::Hint).U8(3).U8((uint8_t)CurrentPlayer(duel)).U32(0).U32(0); break;
+		default: WriteMove(duel, w, LOCATION_GRAVE); break;
+	}
+	if(Chance(duel, duel.settings.select))
+		WriteSelect(duel, w);
+}
+
+void BusyWork(unsigned int nanoseconds)
+{
+	if(nanoseconds == 0)
+		return;
+	const auto end = std::chrono::steady_clock::now() + std::chrono::nanoseconds(nanoseconds);
+	while(std::chrono::steady_clock::now() < end)
+	{}
+}
+
+MockDuel& Get(long pduel)
+{
+	return *(MockDuel*)pduel;
+}
+
+} // namespace
+
+MOCK_EXPORT void set_script_reader(script_reader f) { scriptReader = f; }
+MOCK_EXPORT void set_card_reader(card_reader f) { cardReader = f; }
+MOCK_EXPORT void set_message_handler(message_handler f) { messageHandler = f; }
+
+MOCK_EXPORT long create_duel(unsigned int seed)
+{
+	MockDuel* duel = new MockDuel();
+	duel->settings = ReadSettings();
+	duel->rng.seed(seed);
+	duel->turn = 0;
+	duel->actionsLeft = 0;
+	duel->lp[0] = duel->lp[1] = 8000;
+	duel->ended = false;
+	duel->waiting = false;
+	return (long)duel;
+}
+
+MOCK_EXPORT void start_duel(long pduel, int)
+{
+	MockDuel& duel = Get(pduel);
+	Writer w(duel.messages);
+	WriteTurn(duel, w);
+}
+
+MOCK_EXPORT void end_duel(long pduel)
+{
+	delete &Get(pduel);
+}
+
+MOCK_EXPORT void set_player_info(long pduel, int playerID, int lp, int, int)
+{
+	if(playerID == 0 || playerID == 1)
+		Get(pduel).lp[playerID] = lp;
+}
+
+MOCK_EXPORT void get_log_message(long, unsigned char* buf)
+{
+	std::strcpy((char*)buf, "mock core");
+}
+
+MOCK_EXPORT int get_message(long pduel, unsigned char* buf)
+{
+	MockDuel& duel = Get(pduel);
+	const int length = (int)duel.messages.size();
+	if(length > 0)
+		std::memcpy(buf, duel.messages.data(), duel.messages.size());
+	duel.messages.clear();
+	return length;
+}
+
+MOCK_EXPORT int process(long pduel)
+{
+	MockDuel& duel = Get(pduel);
+	BusyWork(duel.settings.work);
+	duel.waiting = false;
+	for(unsigned int events = 0; events < duel.settings.batch && !duel.waiting && !duel.ended &&
+	    duel.messages.size() < BATCH_BYTES; ++events)
+		Step(duel);
+	// Ended duels keep saying so
+	if(duel.ended && duel.messages.empty())
+		Writer(duel.messages).Message(CoreMessage::Win).U8(0).U8(0);
+	return (int)duel.messages.size();
+}
+
+MOCK_EXPORT void new_card(long pduel, unsigned int code, unsigned char owner, unsigned char playerID,
+                          unsigned char location, unsigned char sequence, unsigned char)
+{
+	if(cardReader != nullptr)
+	{
+		YGOpen::CardData data;
+		cardReader(code, &data);
+	}
+	(void)owner;
+	Get(pduel).cards.push_back(MockCard{code, playerID, location, sequence});
+}
+
+MOCK_EXPORT void new_tag_card(long pduel, unsigned int code, unsigned char owner, unsigned char location)
+{
+	new_card(pduel, code, owner, owner, location, 0, 0);
+}
+
+MOCK_EXPORT void new_relay_card(long pduel, unsigned int code, unsigned char owner, unsigned char location, unsigned char)
+{
+	new_card(pduel, code, owner, owner, location, 0, 0);
+}
+
+MOCK_EXPORT int query_card(long, unsigned char, unsigned char, unsigned char, int, unsigned char* buf, int)
+{
+	// Only the length of an empty query
+	const int32_t length = 4;
+	std::memcpy(buf, &length, sizeof(length));
+	return 4;
+}
+
+MOCK_EXPORT int query_field_count(long pduel, unsigned char playerID, unsigned char location)
+{
+	int count = 0;
+	for(const MockCard& card : Get(pduel).cards)
+		count += (card.controller == playerID && card.location == location);
+	return count;
+}
+
+MOCK_EXPORT int query_field_card(long pduel, unsigned char playerID, unsigned char location, int, unsigned char* buf, int)
+{
+	const int count = query_field_count(pduel, playerID, location);
+	const int32_t length = 4;
+	for(int i = 0; i < count; ++i)
+		std::memcpy(buf + 4 * i, &length, sizeof(length));
+	return 4 * count;
+}
+
+MOCK_EXPORT int query_field_info(long pduel, unsigned char* buf)
+{
+	const MockDuel& duel = Get(pduel);
+	std::vector<unsigned char> info;
+	Writer(info).Message(CoreMessage::ReloadField).U8(0).U32((uint32_t)duel.lp[0]).U32((uint32_t)duel.lp[1]);
+	std::memcpy(buf, info.data(), info.size());
+	return (int)info.size();
+}
+
+MOCK_EXPORT void set_responsei(long, int) {}
+MOCK_EXPORT void set_responseb(long, unsigned char*) {}
+
+MOCK_EXPORT int preload_script(long, char* script, int len)
+{
+	if(len > 0 || scriptReader == nullptr)
+		return 1;
+	int length = 0;
+	return scriptReader(script, &length) != nullptr;
+}
+
+MOCK_EXPORT const char* query_version_string(void)
+{
+	return "mock";
+}
+
+MOCK_EXPORT unsigned int query_capabilities(void)
+{
+	return 1u << 8; // CoreCapability::MessageLength
+}
@@ -0,0 +1,87 @@
+// Packs script directories into an archive that
+// ScriptProvider::AddArchive can map.
+// Usage: ygopen-script-archive [-c <compiler> -v <core version>] <output> <directory> [directory...]
+// Scripts are stored by file name, later directories override earlier ones.
+// With -c every script is compiled with "<compiler> -s -o <file> <script>"
+// (i.e. the luac matching the core) and the archive is meant for
+// ScriptProvider::SetBytecodeArchive instead.
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../script_archive.hpp"
+#include "../util/file_list.hpp"
+
+static std::string Quote(const std::string& arg)
+{
+#ifdef _WIN32
+	return "\"" + arg + "\"";
+#else
+	std::string quoted = "'";
+	for(char c : arg)
+	{
+		if(c == '\'')
+			quoted += "'\\''";
+		else
+			quoted += c;
+	}
+	return quoted + "'";
+#endif
+}
+
+int main(int argc, char* argv[])
+{
+	std::string compiler;
+	std::string coreVersion;
+	int i = 1;
+	for(; i + 1 < argc && argv[i][0] == '-'; i += 2)
+	{
+		if(std::strcmp(argv[i], "-c") == 0)
+			compiler = argv[i + 1];
+		else if(std::strcmp(argv[i], "-v") == 0)
+			coreVersion = argv[i + 1];
+		else
+			break;
+	}
+
+	if(argc - i < 2 || compiler.empty() != coreVersion.empty())
+	{
+		std::printf("Usage: %s [-c <compiler> -v <core version>] <output> <directory> [directory...]\n", argv[0]);
+		return 1;
+	}
+
+	const char* output = argv[i];
+	std::vector<std::string> files;
+	for(++i; i < argc; ++i)
+		YGOpen::ListFiles(argv[i], files);
+
+	YGOpen::ScriptArchive::Compiler compile;
+	if(!compiler.empty())
+	{
+		const std::string compiled = std::string(output) + ".tmp";
+		compile = [compiler, compiled](const std::string& path, std::string& bytecode) -> bool
+		{
+			const std::string command = Quote(compiler) + " -s -o " + Quote(compiled) + " " + Quote(path);
+			if(std::system(command.c_str()) != 0)
+				return false;
+			std::FILE* fp = std::fopen(compiled.c_str(), "rb");
+			if(fp == nullptr)
+				return false;
+			char buffer[16384];
+			std::size_t read;
+			while((read = std::fread(buffer, 1, sizeof(buffer), fp)) > 0)
+				bytecode.append(buffer, read);
+			std::fclose(fp);
+			std::remove(compiled.c_str());
+			return true;
+		};
+	}
+
+	if(!YGOpen::ScriptArchive::Build(output, files, coreVersion, compile))
+		return 1;
+
+	std::printf("Wrote %s\n", output);
+	return 0;
+}
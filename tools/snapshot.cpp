@@ -0,0 +1,32 @@
+// Compiles one or more card databases into a snapshot that
+// DatabaseManager::LoadSnapshot can map.
+// Usage: ygopen-snapshot <output> <database.cdb> [database.cdb...]
+// Databases are loaded in order, later ones override earlier ones.
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "../database_manager.hpp"
+
+int main(int argc, char* argv[])
+{
+	if(argc < 3)
+	{
+		std::printf("Usage: %s <output> <database.cdb> [database.cdb...]\n", argv[0]);
+		return 1;
+	}
+
+	// Loaded at once, so the cards are only merged once
+	YGOpen::DatabaseManager dbm;
+	if(!dbm.LoadDatabases(std::vector<std::string>(argv + 2, argv + argc)))
+	{
+		std::printf("Failed loading the databases\n");
+		return 1;
+	}
+
+	if(!dbm.SaveSnapshot(argv[1]))
+		return 1;
+
+	std::printf("Wrote %s\n", argv[1]);
+	return 0;
+}
@@ -0,0 +1,67 @@
+#include "file_list.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+namespace YGOpen
+{
+
+std::string FileName(const std::string& path)
+{
+	const std::size_t pos = path.find_last_of("/\\");
+	return (pos == std::string::npos) ? path : path.substr(pos + 1);
+}
+
+#ifdef _WIN32
+
+void ListFiles(const std::string& dir, std::vector<std::string>& files)
+{
+	WIN32_FIND_DATAA fd;
+	HANDLE handle = FindFirstFileA((dir + "\\*").c_str(), &fd);
+	if(handle == INVALID_HANDLE_VALUE)
+		return;
+	do
+	{
+		const std::string name = fd.cFileName;
+		if(name == "." || name == "..")
+			continue;
+		if(fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+			ListFiles(dir + "/" + name, files);
+		else
+			files.push_back(dir + "/" + name);
+	}
+	while(FindNextFileA(handle, &fd));
+	FindClose(handle);
+}
+
+#else
+
+void ListFiles(const std::string& dir, std::vector<std::string>& files)
+{
+	DIR* d = opendir(dir.c_str());
+	if(d == nullptr)
+		return;
+	while(struct dirent* entry = readdir(d))
+	{
+		const std::string name = entry->d_name;
+		if(name == "." || name == "..")
+			continue;
+		const std::string path = dir + "/" + name;
+		struct stat st;
+		if(stat(path.c_str(), &st) != 0)
+			continue;
+		if(S_ISDIR(st.st_mode))
+			ListFiles(path, files);
+		else if(S_ISREG(st.st_mode))
+			files.push_back(path);
+	}
+	closedir(d);
+}
+
+#endif
+
+} // namespace YGOpen
@@ -0,0 +1,17 @@
+#ifndef __FILE_LIST_HPP__
+#define __FILE_LIST_HPP__
+#include <string>
+#include <vector>
+
+namespace YGOpen
+{
+
+// Appends the path of every regular file under dir, recursively
+void ListFiles(const std::string& dir, std::vector<std::string>& files);
+
+// Last component of a path
+std::string FileName(const std::string& path);
+
+} // namespace YGOpen
+
+#endif // __FILE_LIST_HPP__
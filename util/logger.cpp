@@ -0,0 +1,387 @@
+#include "logger.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace YGOpen
+{
+
+// Single producer (the owning thread), single consumer (the log thread)
+struct LogRing
+{
+	static const uint32_t SIZE = 1024; // Power of two
+
+	std::atomic<uint32_t> head; // Next record to write
+	std::atomic<uint32_t> tail; // Next record to read
+	std::atomic<bool> orphaned; // The owning thread exited
+	LogRecord records[SIZE];
+
+	LogRing() : head(0), tail(0), orphaned(false) {}
+};
+
+class LogService
+{
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::vector<std::shared_ptr<LogRing>> rings;
+	unsigned long long flushRequested;
+	unsigned long long flushDone;
+	bool stop;
+	std::thread thread;
+
+	void Run();
+	bool Drain(LogRing& ring, std::string& line);
+public:
+	std::atomic<std::FILE*> output;
+	std::atomic<uint8_t> level;
+	std::atomic<std::size_t> dropped;
+
+	LogService();
+	~LogService();
+
+	void Register(const std::shared_ptr<LogRing>& ring);
+	void Flush();
+};
+
+// Marks the thread's ring so the log thread frees it once drained
+struct LogRingHolder
+{
+	std::shared_ptr<LogRing> ring;
+
+	~LogRingHolder()
+	{
+		if(ring)
+			ring->orphaned.store(true, std::memory_order_release);
+	}
+};
+
+static thread_local LogRingHolder ringHolder;
+
+static LogService& Service()
+{
+	static LogService service;
+	return service;
+}
+
+static const char* LevelName(LogLevel level)
+{
+	switch(level)
+	{
+		case LogLevel::Debug: return "Debug";
+		case LogLevel::Info: return "Info";
+		case LogLevel::Warning: return "Warning";
+		case LogLevel::Error: return "Error";
+	}
+	return "?";
+}
+
+static const char* CategoryName(LogCategory category)
+{
+	switch(category)
+	{
+		case LogCategory::General: return "General";
+		case LogCategory::Core: return "Core";
+		case LogCategory::Database: return "Database";
+		case LogCategory::Script: return "Script";
+		case LogCategory::Banlist: return "Banlist";
+		case LogCategory::Duel: return "Duel";
+	}
+	return "?";
+}
+
+// Formats one conversion of record.format. The length modifiers of the
+// format string are replaced, arguments were widened when recorded.
+static void FormatArg(const LogRecord& record, const LogRecord::Arg& arg, std::string spec, char conversion, std::string& line)
+{
+	typedef LogRecord::ArgType ArgType;
+	char buffer[256];
+	int written = 0;
+	switch(conversion)
+	{
+		case 'd': case 'i':
+		{
+			const long long value = (arg.type == ArgType::Signed) ? arg.i :
+			                        (arg.type == ArgType::Double) ? (long long)arg.d : (long long)arg.u;
+			written = std::snprintf(buffer, sizeof(buffer), (spec + "lld").c_str(), value);
+			break;
+		}
+		case 'u': case 'o': case 'x': case 'X':
+		{
+			const unsigned long long value = (arg.type == ArgType::Double) ? (unsigned long long)arg.d : arg.u;
+			written = std::snprintf(buffer, sizeof(buffer), (spec + "ll" + conversion).c_str(), value);
+			break;
+		}
+		case 'c':
+			written = std::snprintf(buffer, sizeof(buffer), (spec + "c").c_str(), (int)arg.i);
+			break;
+		case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+		{
+			const double value = (arg.type == ArgType::Double) ? arg.d :
+			                     (arg.type == ArgType::Signed) ? (double)arg.i : (double)arg.u;
+			written = std::snprintf(buffer, sizeof(buffer), (spec + conversion).c_str(), value);
+			break;
+		}
+		case 's':
+		{
+			const char* str = (arg.type == ArgType::String) ? record.text + arg.offset : "(?)";
+			written = std::snprintf(buffer, sizeof(buffer), (spec + "s").c_str(), str);
+			break;
+		}
+		case 'p':
+			written = std::snprintf(buffer, sizeof(buffer), "%p", arg.p);
+			break;
+		default:
+			line += spec;
+			line += conversion;
+			return;
+	}
+	if(written > 0)
+		line.append(buffer, std::min<std::size_t>((std::size_t)written, sizeof(buffer) - 1));
+}
+
+static void Format(const LogRecord& record, std::string& line)
+{
+	line = "[";
+	line += LevelName(record.level);
+	line += "][";
+	line += CategoryName(record.category);
+	line += "] ";
+
+	std::size_t argIndex = 0;
+	for(const char* p = record.format; *p != '\0'; ++p)
+	{
+		if(*p != '%')
+		{
+			line += *p;
+			continue;
+		}
+		if(p[1] == '%')
+		{
+			line += '%';
+			++p;
+			continue;
+		}
+
+		// %[flags][width][.precision][length]conversion
+		const char* start = p++;
+		while(*p != '\0' && std::strchr("-+ #0", *p) != nullptr)
+			++p;
+		while(*p >= '0' && *p <= '9')
+			++p;
+		if(*p == '.')
+		{
+			++p;
+			while(*p >= '0' && *p <= '9')
+				++p;
+		}
+		std::string spec(start, p);
+		while(*p != '\0' && std::strchr("hlLqjzt", *p) != nullptr)
+			++p;
+		if(*p == '\0')
+		{
+			line += spec;
+			break;
+		}
+		if(argIndex >= record.argCount)
+		{
+			line += spec;
+			line += *p;
+			continue;
+		}
+		FormatArg(record, record.args[argIndex++], spec, *p, line);
+	}
+
+	// Messages are one line each
+	if(!line.empty() && line.back() == '\n')
+		line.pop_back();
+	line += '\n';
+}
+
+LogService::LogService() :
+	flushRequested(0),
+	flushDone(0),
+	stop(false),
+	output(stdout),
+	level((uint8_t)LogLevel::Info),
+	dropped(0)
+{
+	thread = std::thread(&LogService::Run, this);
+}
+
+LogService::~LogService()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stop = true;
+	}
+	cv.notify_all();
+	thread.join();
+}
+
+void LogService::Register(const std::shared_ptr<LogRing>& ring)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	rings.push_back(ring);
+}
+
+void LogService::Flush()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	const unsigned long long ticket = ++flushRequested;
+	cv.notify_all();
+	cv.wait(lock, [&]() { return flushDone >= ticket; });
+}
+
+bool LogService::Drain(LogRing& ring, std::string& line)
+{
+	std::FILE* fp = output.load(std::memory_order_relaxed);
+	uint32_t tail = ring.tail.load(std::memory_order_relaxed);
+	const uint32_t head = ring.head.load(std::memory_order_acquire);
+	if(tail == head)
+		return false;
+	for(; tail != head; ++tail)
+	{
+		Format(ring.records[tail & (LogRing::SIZE - 1)], line);
+		ring.tail.store(tail + 1, std::memory_order_release);
+		std::fputs(line.c_str(), fp);
+	}
+	return true;
+}
+
+void LogService::Run()
+{
+	std::string line;
+	std::vector<std::shared_ptr<LogRing>> current;
+	std::unique_lock<std::mutex> lock(mutex);
+	while(true)
+	{
+		const unsigned long long ticket = flushRequested;
+		const bool stopping = stop;
+		current = rings;
+		lock.unlock();
+
+		bool wrote = false;
+		for(auto& ring : current)
+			wrote |= Drain(*ring, line);
+		if(wrote)
+			std::fflush(output.load(std::memory_order_relaxed));
+
+		lock.lock();
+		rings.erase(std::remove_if(rings.begin(), rings.end(), [](const std::shared_ptr<LogRing>& ring)
+		{
+			return ring->orphaned.load(std::memory_order_acquire) &&
+			       ring->tail.load(std::memory_order_relaxed) == ring->head.load(std::memory_order_acquire);
+		}), rings.end());
+		flushDone = ticket;
+		cv.notify_all();
+
+		if(stopping && !wrote)
+			return;
+		if(!wrote && flushRequested == ticket && !stop)
+			cv.wait_for(lock, std::chrono::milliseconds(5));
+	}
+}
+
+void LogRecord::AddSigned(long long value)
+{
+	args[argCount].type = ArgType::Signed;
+	args[argCount++].i = value;
+}
+
+void LogRecord::AddUnsigned(unsigned long long value)
+{
+	args[argCount].type = ArgType::Unsigned;
+	args[argCount++].u = value;
+}
+
+void LogRecord::AddDouble(double value)
+{
+	args[argCount].type = ArgType::Double;
+	args[argCount++].d = value;
+}
+
+void LogRecord::AddPointer(const void* value)
+{
+	args[argCount].type = ArgType::Pointer;
+	args[argCount++].p = value;
+}
+
+void LogRecord::AddString(const char* str, std::size_t length)
+{
+	// Truncated to whatever is left of text
+	if(textSize >= TEXT_SIZE)
+	{
+		args[argCount].type = ArgType::String;
+		args[argCount++].offset = TEXT_SIZE - 1; // The last terminator
+		return;
+	}
+	length = std::min(length, TEXT_SIZE - textSize - 1);
+	args[argCount].type = ArgType::String;
+	args[argCount++].offset = textSize;
+	if(length > 0)
+		std::memcpy(text + textSize, str, length);
+	text[textSize + length] = '\0';
+	textSize = (uint16_t)(textSize + length + 1);
+}
+
+bool Logger::Enabled(LogLevel level)
+{
+	return (uint8_t)level >= Service().level.load(std::memory_order_relaxed);
+}
+
+LogRecord* Logger::Begin()
+{
+	LogRing* ring = ringHolder.ring.get();
+	if(ring == nullptr)
+	{
+		ringHolder.ring = std::make_shared<LogRing>();
+		ring = ringHolder.ring.get();
+		Service().Register(ringHolder.ring);
+	}
+
+	const uint32_t head = ring->head.load(std::memory_order_relaxed);
+	if(head - ring->tail.load(std::memory_order_acquire) >= LogRing::SIZE)
+	{
+		Service().dropped.fetch_add(1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	LogRecord* record = &ring->records[head & (LogRing::SIZE - 1)];
+	record->argCount = 0;
+	record->textSize = 0;
+	return record;
+}
+
+void Logger::Commit()
+{
+	LogRing* ring = ringHolder.ring.get();
+	ring->head.store(ring->head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void Logger::SetLevel(LogLevel level)
+{
+	Service().level.store((uint8_t)level, std::memory_order_relaxed);
+}
+
+void Logger::SetOutput(std::FILE* fp)
+{
+	Service().output.store(fp, std::memory_order_relaxed);
+}
+
+void Logger::Flush()
+{
+	Service().Flush();
+}
+
+std::size_t Logger::Dropped()
+{
+	return Service().dropped.load(std::memory_order_relaxed);
+}
+
+} // namespace YGOpen
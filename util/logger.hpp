@@ -0,0 +1,163 @@
+#ifndef __LOGGER_HPP__
+#define __LOGGER_HPP__
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+namespace YGOpen
+{
+
+enum class LogLevel : uint8_t
+{
+	Debug,
+	Info,
+	Warning,
+	Error,
+};
+
+enum class LogCategory : uint8_t
+{
+	General,
+	Core,
+	Database,
+	Script,
+	Banlist,
+	Duel,
+};
+
+// One unformatted message: the format string and a copy of its arguments
+struct LogRecord
+{
+	static const std::size_t MAX_ARGS = 8;
+	static const std::size_t TEXT_SIZE = 192;
+
+	enum class ArgType : uint8_t
+	{
+		Signed,
+		Unsigned,
+		Double,
+		String,
+		Pointer,
+	};
+
+	struct Arg
+	{
+		ArgType type;
+		union
+		{
+			long long i;
+			unsigned long long u;
+			double d;
+			const void* p;
+			uint32_t offset; // Into text, null terminated
+		};
+	};
+
+	const char* format;
+	LogLevel level;
+	LogCategory category;
+	uint8_t argCount;
+	uint16_t textSize;
+	Arg args[MAX_ARGS];
+	char text[TEXT_SIZE]; // Copies of the string arguments
+
+	void AddSigned(long long value);
+	void AddUnsigned(unsigned long long value);
+	void AddDouble(double value);
+	void AddPointer(const void* value);
+	void AddString(const char* str, std::size_t length);
+};
+
+// Log calls only copy their arguments into a record on a ring buffer
+// owned by the calling thread, without locking; a background thread
+// formats and writes the records. If a thread logs faster than that the
+// records that do not fit are dropped, the calling thread never waits.
+//
+// Format strings are printf-like and must outlive the logger (i.e. be
+// string literals). Strings arguments are copied, up to TEXT_SIZE bytes.
+class Logger
+{
+	static bool Enabled(LogLevel level);
+	static LogRecord* Begin();
+	static void Commit();
+
+	static void Pack(LogRecord&) {}
+	template<typename T, typename... Args>
+	static void Pack(LogRecord& record, const T& value, const Args&... args)
+	{
+		Encode(record, value);
+		Pack(record, args...);
+	}
+
+	template<typename T>
+	static typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type
+	Encode(LogRecord& record, T value) { record.AddSigned(value); }
+	template<typename T>
+	static typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type
+	Encode(LogRecord& record, T value) { record.AddUnsigned(value); }
+	template<typename T>
+	static typename std::enable_if<std::is_enum<T>::value>::type
+	Encode(LogRecord& record, T value) { record.AddSigned((long long)value); }
+	template<typename T>
+	static typename std::enable_if<std::is_floating_point<T>::value>::type
+	Encode(LogRecord& record, T value) { record.AddDouble(value); }
+	template<typename T>
+	static typename std::enable_if<std::is_pointer<T>::value &&
+	                               !std::is_same<typename std::remove_cv<typename std::remove_pointer<T>::type>::type, char>::value>::type
+	Encode(LogRecord& record, T value) { record.AddPointer((const void*)value); }
+	static void Encode(LogRecord& record, const char* str) { record.AddString(str, str ? std::strlen(str) : 0); }
+	static void Encode(LogRecord& record, const std::string& str) { record.AddString(str.data(), str.size()); }
+public:
+	template<typename... Args>
+	static void Write(LogLevel level, LogCategory category, const char* format, const Args&... args)
+	{
+		static_assert(sizeof...(Args) <= LogRecord::MAX_ARGS, "Too many log arguments");
+		if(!Enabled(level))
+			return;
+		LogRecord* record = Begin();
+		if(record == nullptr)
+			return;
+		record->format = format;
+		record->level = level;
+		record->category = category;
+		Pack(*record, args...);
+		Commit();
+	}
+
+	template<typename... Args>
+	static void Debug(LogCategory category, const char* format, const Args&... args)
+	{
+		Write(LogLevel::Debug, category, format, args...);
+	}
+	template<typename... Args>
+	static void Info(LogCategory category, const char* format, const Args&... args)
+	{
+		Write(LogLevel::Info, category, format, args...);
+	}
+	template<typename... Args>
+	static void Warning(LogCategory category, const char* format, const Args&... args)
+	{
+		Write(LogLevel::Warning, category, format, args...);
+	}
+	template<typename... Args>
+	static void Error(LogCategory category, const char* format, const Args&... args)
+	{
+		Write(LogLevel::Error, category, format, args...);
+	}
+
+	// Messages below level are discarded at the call, Info by default
+	static void SetLevel(LogLevel level);
+	// Where formatted messages are written, stdout by default
+	static void SetOutput(std::FILE* fp);
+	// Blocks until every message logged before the call is written
+	static void Flush();
+	// Messages lost because a thread's buffer was full
+	static std::size_t Dropped();
+};
+
+} // namespace YGOpen
+
+#endif // __LOGGER_HPP__
@@ -0,0 +1,144 @@
+#include "mapped_file.hpp"
+
+#include "logger.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace YGOpen
+{
+
+MappedFile::MappedFile() :
+	data(nullptr),
+	size(0)
+#ifdef _WIN32
+	, fileHandle(nullptr),
+	mapHandle(nullptr)
+#endif
+{}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const char* path)
+{
+	Close();
+
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if(file == INVALID_HANDLE_VALUE)
+	{
+		Logger::Error(LogCategory::General, "Failed opening %s", path);
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if(!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if(mapping == nullptr)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if(data == nullptr)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	size = (std::size_t)fileSize.QuadPart;
+	fileHandle = (void*)file;
+	mapHandle = (void*)mapping;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if(data != nullptr)
+		UnmapViewOfFile(data);
+	if(mapHandle != nullptr)
+		CloseHandle((HANDLE)mapHandle);
+	if(fileHandle != nullptr)
+		CloseHandle((HANDLE)fileHandle);
+	data = nullptr;
+	size = 0;
+	fileHandle = nullptr;
+	mapHandle = nullptr;
+}
+
+#else
+
+bool MappedFile::Open(const char* path)
+{
+	Close();
+
+	int fd = open(path, O_RDONLY);
+	if(fd < 0)
+	{
+		Logger::Error(LogCategory::General, "Failed opening %s", path);
+		return false;
+	}
+
+	struct stat st;
+	if(fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	void* addr = mmap(nullptr, (std::size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd); // The mapping keeps its own reference to the file
+	if(addr == MAP_FAILED)
+	{
+		Logger::Error(LogCategory::General, "Failed mapping %s", path);
+		return false;
+	}
+
+	data = addr;
+	size = (std::size_t)st.st_size;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if(data != nullptr)
+		munmap(data, size);
+	data = nullptr;
+	size = 0;
+}
+
+#endif
+
+bool MappedFile::IsOpen() const
+{
+	return data != nullptr;
+}
+
+const void* MappedFile::Data() const
+{
+	return data;
+}
+
+std::size_t MappedFile::Size() const
+{
+	return size;
+}
+
+} // namespace YGOpen
@@ -0,0 +1,34 @@
+#ifndef __MAPPED_FILE_HPP__
+#define __MAPPED_FILE_HPP__
+#include <cstddef>
+
+namespace YGOpen
+{
+
+// Read-only memory mapping of a whole file
+class MappedFile
+{
+	void* data;
+	std::size_t size;
+#ifdef _WIN32
+	void* fileHandle;
+	void* mapHandle;
+#endif
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool Open(const char* path);
+	void Close();
+
+	bool IsOpen() const;
+	const void* Data() const;
+	std::size_t Size() const;
+};
+
+} // namespace YGOpen
+
+#endif // __MAPPED_FILE_HPP__
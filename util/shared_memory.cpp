@@ -0,0 +1,201 @@
+#include "shared_memory.hpp"
+
+#include "logger.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace YGOpen
+{
+
+SharedMemory::SharedMemory() :
+	data(nullptr),
+	size(0),
+	owner(false)
+#ifdef _WIN32
+	, mapHandle(nullptr)
+#endif
+{}
+
+SharedMemory::~SharedMemory()
+{
+	Close();
+}
+
+#ifdef _WIN32
+
+// Names are used as given, e.g. "Local\\ygopen-sandbox-1"
+static bool Map(const std::string& name, std::size_t size, bool create, void** data, void** mapHandle)
+{
+	HANDLE mapping;
+	if(create)
+	{
+		mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+		                             (DWORD)((unsigned long long)size >> 32), (DWORD)size, name.c_str());
+		if(mapping != nullptr && GetLastError() == ERROR_ALREADY_EXISTS)
+		{
+			CloseHandle(mapping);
+			mapping = nullptr;
+		}
+	}
+	else
+	{
+		mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name.c_str());
+	}
+	if(mapping == nullptr)
+		return false;
+
+	*data = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+	if(*data == nullptr)
+	{
+		CloseHandle(mapping);
+		return false;
+	}
+	*mapHandle = (void*)mapping;
+	return true;
+}
+
+bool SharedMemory::Create(const std::string& name, std::size_t size)
+{
+	Close();
+	if(!Map(name, size, true, &data, &mapHandle))
+	{
+		Logger::Error(LogCategory::General, "Failed creating shared memory %s", name);
+		return false;
+	}
+	this->name = name;
+	this->size = size;
+	owner = true;
+	return true;
+}
+
+bool SharedMemory::Open(const std::string& name, std::size_t size)
+{
+	Close();
+	if(!Map(name, size, false, &data, &mapHandle))
+	{
+		Logger::Error(LogCategory::General, "Failed opening shared memory %s", name);
+		return false;
+	}
+	this->name = name;
+	this->size = size;
+	return true;
+}
+
+void SharedMemory::Close()
+{
+	// The mapping goes away with its last handle
+	if(data != nullptr)
+		UnmapViewOfFile(data);
+	if(mapHandle != nullptr)
+		CloseHandle((HANDLE)mapHandle);
+	data = nullptr;
+	size = 0;
+	name.clear();
+	owner = false;
+	mapHandle = nullptr;
+}
+
+// Named mappings go away with their last handle
+void SharedMemory::Remove(const std::string&)
+{}
+
+#else
+
+// Names follow shm_open, e.g. "/ygopen-sandbox-1"
+bool SharedMemory::Create(const std::string& name, std::size_t size)
+{
+	Close();
+	int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+	if(fd < 0)
+	{
+		Logger::Error(LogCategory::General, "Failed creating shared memory %s", name);
+		return false;
+	}
+
+	void* addr = MAP_FAILED;
+	if(ftruncate(fd, (off_t)size) == 0)
+		addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if(addr == MAP_FAILED)
+	{
+		Logger::Error(LogCategory::General, "Failed mapping shared memory %s", name);
+		shm_unlink(name.c_str());
+		return false;
+	}
+
+	data = addr;
+	this->size = size;
+	this->name = name;
+	owner = true;
+	return true;
+}
+
+bool SharedMemory::Open(const std::string& name, std::size_t size)
+{
+	Close();
+	int fd = shm_open(name.c_str(), O_RDWR, 0600);
+	if(fd < 0)
+	{
+		Logger::Error(LogCategory::General, "Failed opening shared memory %s", name);
+		return false;
+	}
+
+	struct stat st;
+	void* addr = MAP_FAILED;
+	if(fstat(fd, &st) == 0 && (std::size_t)st.st_size >= size)
+		addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if(addr == MAP_FAILED)
+	{
+		Logger::Error(LogCategory::General, "Failed mapping shared memory %s", name);
+		return false;
+	}
+
+	data = addr;
+	this->size = size;
+	this->name = name;
+	return true;
+}
+
+void SharedMemory::Close()
+{
+	if(data != nullptr)
+		munmap(data, size);
+	if(owner)
+		shm_unlink(name.c_str());
+	data = nullptr;
+	size = 0;
+	name.clear();
+	owner = false;
+}
+
+void SharedMemory::Remove(const std::string& name)
+{
+	shm_unlink(name.c_str());
+}
+
+#endif
+
+bool SharedMemory::IsOpen() const
+{
+	return data != nullptr;
+}
+
+void* SharedMemory::Data() const
+{
+	return data;
+}
+
+std::size_t SharedMemory::Size() const
+{
+	return size;
+}
+
+} // namespace YGOpen
@@ -0,0 +1,40 @@
+#ifndef __SHARED_MEMORY_HPP__
+#define __SHARED_MEMORY_HPP__
+#include <cstddef>
+#include <string>
+
+namespace YGOpen
+{
+
+// Named read-write memory shared between processes
+class SharedMemory
+{
+	void* data;
+	std::size_t size;
+	std::string name;
+	bool owner; // Created it, so removes the name when closed
+#ifdef _WIN32
+	void* mapHandle;
+#endif
+
+	SharedMemory(const SharedMemory&) = delete;
+	SharedMemory& operator=(const SharedMemory&) = delete;
+public:
+	SharedMemory();
+	~SharedMemory();
+
+	// Zero filled, fails if the name is already in use
+	bool Create(const std::string& name, std::size_t size);
+	bool Open(const std::string& name, std::size_t size);
+	void Close();
+	// Removes the name of memory created by a process that is gone
+	static void Remove(const std::string& name);
+
+	bool IsOpen() const;
+	void* Data() const;
+	std::size_t Size() const;
+};
+
+} // namespace YGOpen
+
+#endif // __SHARED_MEMORY_HPP__
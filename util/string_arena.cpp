@@ -0,0 +1,103 @@
+#include "string_arena.hpp"
+
+namespace YGOpen
+{
+
+static const std::size_t MIN_CAPACITY = 64;
+
+static inline uint32_t HashString(const char* str, std::size_t length)
+{
+	uint32_t h = 2166136261u; // FNV-1a
+	for(std::size_t i = 0; i < length; ++i)
+	{
+		h ^= (unsigned char)str[i];
+		h *= 16777619u;
+	}
+	return h;
+}
+
+StringArena::StringArena() : count(0)
+{}
+
+void StringArena::Rehash(std::size_t capacity)
+{
+	std::vector<Slot> old;
+	old.swap(slots);
+	slots.assign(capacity, Slot{0, {0, 0}});
+	const std::size_t mask = capacity - 1;
+	for(auto& slot : old)
+	{
+		if(slot.ref.length == 0)
+			continue;
+		std::size_t i = slot.hash & mask;
+		while(slots[i].ref.length != 0)
+			i = (i + 1) & mask;
+		slots[i] = slot;
+	}
+}
+
+void StringArena::Reserve(std::size_t bytes, std::size_t strings)
+{
+	data.reserve(bytes);
+	std::size_t capacity = MIN_CAPACITY;
+	while(capacity < strings * 2)
+		capacity <<= 1;
+	if(capacity > slots.size())
+		Rehash(capacity);
+}
+
+void StringArena::Clear()
+{
+	data.clear();
+	slots.clear();
+	count = 0;
+}
+
+TextRef StringArena::Intern(const char* str, std::size_t length)
+{
+	TextRef ref = {0, 0};
+	if(length == 0)
+		return ref;
+
+	if(slots.empty() || (count + 1) * 2 > slots.size())
+		Rehash(slots.empty() ? MIN_CAPACITY : slots.size() * 2);
+
+	const uint32_t hash = HashString(str, length);
+	const std::size_t mask = slots.size() - 1;
+	std::size_t i = hash & mask;
+	while(slots[i].ref.length != 0)
+	{
+		const Slot& slot = slots[i];
+		if(slot.hash == hash && slot.ref.length == length &&
+		   std::memcmp(&data[slot.ref.offset], str, length) == 0)
+			return slot.ref;
+		i = (i + 1) & mask;
+	}
+
+	ref.offset = (uint32_t)data.size();
+	ref.length = (uint32_t)length;
+	data.insert(data.end(), str, str + length);
+	slots[i].hash = hash;
+	slots[i].ref = ref;
+	++count;
+	return ref;
+}
+
+StringView StringArena::Get(const TextRef& ref) const
+{
+	if(ref.length == 0)
+		return StringView();
+	return StringView(&data[ref.offset], ref.length);
+}
+
+const char* StringArena::Data() const
+{
+	return data.data();
+}
+
+std::size_t StringArena::Size() const
+{
+	return data.size();
+}
+
+} // namespace YGOpen
@@ -0,0 +1,74 @@
+#ifndef __STRING_ARENA_HPP__
+#define __STRING_ARENA_HPP__
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace YGOpen
+{
+
+// Non-owning view over characters stored somewhere else
+class StringView
+{
+	const char* ptr;
+	std::size_t len;
+public:
+	StringView() : ptr(""), len(0) {}
+	StringView(const char* data, std::size_t size) : ptr(data), len(size) {}
+
+	const char* Data() const { return ptr; }
+	std::size_t Size() const { return len; }
+	bool Empty() const { return len == 0; }
+	std::string ToString() const { return std::string(ptr, len); }
+
+	bool operator==(const StringView& other) const
+	{
+		return len == other.len && std::memcmp(ptr, other.ptr, len) == 0;
+	}
+	bool operator!=(const StringView& other) const
+	{
+		return !(*this == other);
+	}
+};
+
+// Location of a string inside an arena; a length of 0 is the empty string
+struct TextRef
+{
+	uint32_t offset;
+	uint32_t length;
+};
+
+// Append-only contiguous string storage. Every distinct string is stored
+// once: the empty string takes no space and repeated strings are interned
+// and share the same TextRef.
+class StringArena
+{
+	struct Slot
+	{
+		uint32_t hash;
+		TextRef ref; // length 0 means the slot is empty
+	};
+
+	std::vector<char> data;
+	std::vector<Slot> slots; // Linear probing, size is always a power of two
+	std::size_t count;
+
+	void Rehash(std::size_t capacity);
+public:
+	StringArena();
+
+	void Reserve(std::size_t bytes, std::size_t strings);
+	void Clear();
+
+	TextRef Intern(const char* str, std::size_t length);
+	StringView Get(const TextRef& ref) const;
+
+	const char* Data() const;
+	std::size_t Size() const;
+};
+
+} // namespace YGOpen
+
+#endif // __STRING_ARENA_HPP__